@@ -0,0 +1,270 @@
+/*!
+Criterion benchmarks for the generation, optimum calculation, evaluation, and I/O hot paths,
+parameterized over (m, k, o, b) shapes and reporting throughput (evaluations or codomain values
+per second), so performance regressions in these paths show up as numbers.
+*/
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+use problem_generator::problem::clique_tree::{CliqueTree, InputParameters, SolutionFit};
+use problem_generator::problem::codomain::{
+    generate_codomain, read_codomain, read_codomain_binary, write_codomain_binary,
+};
+use problem_generator::problem::codomain_subclasses::CodomainFunction;
+use problem_generator::problem::configuration::get_rng;
+use problem_generator::problem::problem_generation::{
+    read_problem_binary, read_problem_from_file, write_problem_binary, write_problem_to_file,
+};
+
+use std::path::PathBuf;
+
+///Fixed seed so every benchmark run measures the same instances
+const BENCH_SEED: u64 = 2398;
+
+///The (m, k, o, b) shapes the parameterized groups run over
+const SHAPES: &[(u32, u32, u32, u32)] = &[(32, 5, 2, 2), (128, 5, 2, 2), (64, 6, 3, 4)];
+
+fn shape_label(input_parameters: &InputParameters) -> String {
+    format!(
+        "{}_{}_{}_{}",
+        input_parameters.m, input_parameters.k, input_parameters.o, input_parameters.b
+    )
+}
+
+///Build a clique tree for the given shape and codomain function, from the fixed benchmark seed
+fn build_clique_tree(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+) -> CliqueTree {
+    let mut rng = get_rng(Some(BENCH_SEED));
+    let codomain = generate_codomain(input_parameters, codomain_function, &mut rng);
+    CliqueTree::new(
+        input_parameters.clone(),
+        codomain_function.clone(),
+        codomain,
+        &mut rng,
+    )
+}
+
+///The number of solution variables for the given shape
+fn problem_size(input_parameters: &InputParameters) -> usize {
+    (input_parameters.k
+        + (input_parameters.m - 1) * (input_parameters.k - input_parameters.o)) as usize
+}
+
+fn bench_construct(c: &mut Criterion) {
+    let mut group = c.benchmark_group("construct");
+    for &(m, k, o, b) in SHAPES {
+        let input_parameters = InputParameters::new_from_primitives(m, k, o, b);
+        group.throughput(Throughput::Elements(m as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(shape_label(&input_parameters)),
+            &input_parameters,
+            |bench, input_parameters| {
+                bench.iter(|| {
+                    let mut rng = get_rng(Some(BENCH_SEED));
+                    CliqueTree::construct(black_box(input_parameters), &mut rng)
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_calculate_global_optima(c: &mut Criterion) {
+    let mut group = c.benchmark_group("calculate_global_optima");
+    //One separable shape, as it takes the dedicated separable path, and the overlapping shapes
+    for &(m, k, o, b) in &[(64, 5, 0, 2), (64, 5, 2, 2), (64, 6, 3, 4)] {
+        let input_parameters = InputParameters::new_from_primitives(m, k, o, b);
+        let codomain_function = CodomainFunction::DeceptiveTrap;
+
+        let mut rng = get_rng(Some(BENCH_SEED));
+        let codomain_values: Vec<f64> =
+            generate_codomain(&input_parameters, &codomain_function, &mut rng)
+                .into_iter()
+                .flatten()
+                .collect();
+        let (cliques, separators) = CliqueTree::construct(&input_parameters, &mut rng);
+
+        //The dynamic program touches every codomain value once
+        group.throughput(Throughput::Elements((m as u64) << k));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(shape_label(&input_parameters)),
+            &input_parameters,
+            |bench, input_parameters| {
+                bench.iter(|| {
+                    CliqueTree::calculate_global_optima_product(
+                        black_box(input_parameters),
+                        &codomain_function,
+                        &codomain_values,
+                        &cliques,
+                        &separators,
+                    )
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_generate_codomain(c: &mut Criterion) {
+    let mut group = c.benchmark_group("generate_codomain");
+    let input_parameters = InputParameters::new_from_primitives(64, 5, 2, 2);
+
+    let codomain_functions = [
+        CodomainFunction::Random,
+        CodomainFunction::Trap,
+        CodomainFunction::DeceptiveTrap,
+        CodomainFunction::NKq { q: 4 },
+        CodomainFunction::NKp { p: 0.2 },
+        CodomainFunction::RandomDeceptiveTrap { p_deceptive: 0.5 },
+        CodomainFunction::VirtualRandom { seed: BENCH_SEED },
+    ];
+
+    //values/sec: every variant produces m * 2^k codomain values
+    group.throughput(Throughput::Elements(
+        (input_parameters.m as u64) << input_parameters.k,
+    ));
+    for codomain_function in &codomain_functions {
+        group.bench_with_input(
+            BenchmarkId::from_parameter(codomain_function.to_io_string()),
+            codomain_function,
+            |bench, codomain_function| {
+                bench.iter(|| {
+                    let mut rng = get_rng(Some(BENCH_SEED));
+                    generate_codomain(&input_parameters, black_box(codomain_function), &mut rng)
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_evaluation(c: &mut Criterion) {
+    let mut group = c.benchmark_group("evaluation");
+    for &(m, k, o, b) in SHAPES {
+        let input_parameters = InputParameters::new_from_primitives(m, k, o, b);
+        let clique_tree = build_clique_tree(&input_parameters, &CodomainFunction::DeceptiveTrap);
+
+        let solution: Vec<u32> = (0..problem_size(&input_parameters))
+            .map(|position| (position % 2) as u32)
+            .collect();
+
+        //evals/sec
+        group.throughput(Throughput::Elements(1));
+        group.bench_function(
+            BenchmarkId::new("calculate_fitness", shape_label(&input_parameters)),
+            |bench| {
+                bench.iter(|| {
+                    let mut number_evaluations = 0;
+                    clique_tree.calculate_fitness(black_box(&solution), &mut number_evaluations)
+                })
+            },
+        );
+
+        let mut number_evaluations = 0;
+        let fitness = clique_tree.calculate_fitness(&solution, &mut number_evaluations);
+        let solution_fit = SolutionFit {
+            solution: solution.clone(),
+            fitness,
+        };
+        group.bench_function(
+            BenchmarkId::new("calculate_fitness_delta", shape_label(&input_parameters)),
+            |bench| {
+                bench.iter(|| {
+                    let mut number_evaluations = 0;
+                    clique_tree.calculate_fitness_delta(
+                        black_box(&solution_fit),
+                        &mut number_evaluations,
+                        black_box(3),
+                    )
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_io_round_trips(c: &mut Criterion) {
+    let mut group = c.benchmark_group("io_round_trip");
+    let input_parameters = InputParameters::new_from_primitives(64, 5, 2, 2);
+    let codomain_function = CodomainFunction::DeceptiveTrap;
+    let clique_tree = build_clique_tree(&input_parameters, &codomain_function);
+    let codomain_values: Vec<f64> = clique_tree.codomain_values.clone();
+
+    let temp_dir = std::env::temp_dir();
+    let codomain_text_path: PathBuf = temp_dir.join("problem_generator_bench_codomain.txt");
+    let codomain_binary_path: PathBuf = temp_dir.join("problem_generator_bench_codomain.bin");
+    let problem_text_path: PathBuf = temp_dir.join("problem_generator_bench_problem.txt");
+    let problem_binary_path: PathBuf = temp_dir.join("problem_generator_bench_problem.bin");
+
+    //values/sec over the m * 2^k codomain values that dominate the file contents
+    group.throughput(Throughput::Elements(
+        (input_parameters.m as u64) << input_parameters.k,
+    ));
+
+    group.bench_function("problem_text_write", |bench| {
+        bench.iter(|| write_problem_to_file(&clique_tree, &problem_text_path).unwrap())
+    });
+    write_problem_to_file(&clique_tree, &problem_text_path).unwrap();
+    group.bench_function("problem_text_read", |bench| {
+        bench.iter(|| read_problem_from_file(&problem_text_path).unwrap())
+    });
+
+    let problem = read_problem_from_file(&problem_text_path).unwrap();
+    group.bench_function("problem_binary_write", |bench| {
+        bench.iter(|| write_problem_binary(&problem, &problem_binary_path).unwrap())
+    });
+    group.bench_function("problem_binary_read", |bench| {
+        bench.iter(|| read_problem_binary(&problem_binary_path).unwrap())
+    });
+
+    //The text codomain reader expects the function and parameter header lines of generated files;
+    // write them through the binary writer's text counterpart once by reusing the generation output
+    problem_generator::problem::codomain::generate_write_return(
+        &input_parameters,
+        &codomain_function,
+        &codomain_text_path,
+        &mut get_rng(Some(BENCH_SEED)),
+    )
+    .unwrap();
+    group.bench_function("codomain_text_read", |bench| {
+        bench.iter(|| read_codomain(&input_parameters, &codomain_text_path, 2).unwrap())
+    });
+
+    group.bench_function("codomain_binary_write", |bench| {
+        bench.iter(|| {
+            write_codomain_binary(
+                &input_parameters,
+                &codomain_function,
+                &codomain_binary_path,
+                &codomain_values,
+            )
+            .unwrap()
+        })
+    });
+    group.bench_function("codomain_binary_read", |bench| {
+        bench.iter(|| read_codomain_binary(&codomain_binary_path).unwrap())
+    });
+
+    group.finish();
+
+    for path in [
+        &codomain_text_path,
+        &codomain_binary_path,
+        &problem_text_path,
+        &problem_binary_path,
+    ] {
+        let _ = std::fs::remove_file(path);
+    }
+}
+
+criterion_group!(
+    benches,
+    bench_construct,
+    bench_calculate_global_optima,
+    bench_generate_codomain,
+    bench_evaluation,
+    bench_io_round_trips
+);
+criterion_main!(benches);
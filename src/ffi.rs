@@ -0,0 +1,220 @@
+/*!
+Module exposing TD Mk Landscape evaluation over a C ABI, for embedding in non-Rust optimizers.
+
+The crate builds as a cdylib next to the Rust library; a C or C++ optimizer loads a problem into
+an opaque handle once and then evaluates bit-packed solutions against it, instead of re-parsing
+the problem and codomain files with its own (diverging) evaluation code.
+
+Solutions are passed as raw packed u64 words: bit i of the solution lives at bit (i % 64) of word
+(i / 64), and a solution takes ceil(problem_size / 64) words. The evaluate, delta and optimum
+checks allocate nothing and take the handle as read-only, so one handle can be shared across all
+optimizer threads.
+
+```c
+tdmk_handle *handle = tdmk_load("problem.txt", "codomain.txt", 1);
+double fitness = tdmk_evaluate(handle, words);
+double flipped = tdmk_evaluate_delta(handle, words, fitness, 3);
+int optimal = tdmk_is_global_optimum(handle, words, fitness);
+tdmk_free(handle);
+```
+*/
+
+use std::ffi::CStr;
+use std::os::raw::{c_char, c_int};
+use std::panic::{self, AssertUnwindSafe};
+use std::path::Path;
+
+use crate::problem::archive::ArchiveReader;
+use crate::problem::clique_tree::CliqueTree;
+use crate::problem::problem_generation::read_clique_tree_from_files;
+
+///Convert a C path string to a Path; None when the pointer is null or not valid UTF-8
+unsafe fn path_from_c_string<'a>(path: *const c_char) -> Option<&'a Path> {
+    if path.is_null() {
+        return None;
+    }
+    CStr::from_ptr(path).to_str().ok().map(Path::new)
+}
+
+///Borrow the packed solution words of a handle's problem from a raw pointer;
+/// the caller guarantees the pointer holds ceil(problem_size / 64) words
+unsafe fn words_from_pointer<'a>(
+    clique_tree: &CliqueTree,
+    packed_solution: *const u64,
+) -> &'a [u64] {
+    std::slice::from_raw_parts(packed_solution, (clique_tree.problem_size() + 63) / 64)
+}
+
+///Load a problem and its codomain file into an opaque handle.
+///`generated` states whether the codomain file contains the codomain function on its first line,
+/// as codomain files written by the generator do.
+///Returns null when either file cannot be read or parsed.
+///
+/// # Safety
+/// The paths must be null-terminated C strings or null.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_load(
+    problem_file_path: *const c_char,
+    codomain_file_path: *const c_char,
+    generated: c_int,
+) -> *mut CliqueTree {
+    let problem_file_path = match path_from_c_string(problem_file_path) {
+        Some(path) => path,
+        None => return std::ptr::null_mut(),
+    };
+    let codomain_file_path = match path_from_c_string(codomain_file_path) {
+        Some(path) => path,
+        None => return std::ptr::null_mut(),
+    };
+    //Parsing and tree construction can still panic on pathological file contents; a panic must
+    // not unwind across the C ABI boundary, so it is caught and reported as null like any other
+    // load failure
+    panic::catch_unwind(AssertUnwindSafe(|| {
+        match read_clique_tree_from_files(problem_file_path, codomain_file_path, generated != 0) {
+            Ok(clique_tree) => Box::into_raw(Box::new(clique_tree)),
+            Err(_) => std::ptr::null_mut(),
+        }
+    }))
+    .unwrap_or(std::ptr::null_mut())
+}
+
+///Load the archive entry at the given index into an opaque handle.
+///Returns null when the archive cannot be read or the index is out of range.
+///
+/// # Safety
+/// The path must be a null-terminated C string or null.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_load_archive_entry(
+    archive_file_path: *const c_char,
+    entry_index: u64,
+) -> *mut CliqueTree {
+    let archive_file_path = match path_from_c_string(archive_file_path) {
+        Some(path) => path,
+        None => return std::ptr::null_mut(),
+    };
+    //As in tdmk_load, a panic on pathological archive contents is caught here instead of
+    // unwinding across the C ABI boundary
+    panic::catch_unwind(AssertUnwindSafe(|| {
+        let archive_reader = match ArchiveReader::open(archive_file_path) {
+            Ok(archive_reader) => archive_reader,
+            Err(_) => return std::ptr::null_mut(),
+        };
+        if entry_index as usize >= archive_reader.len() {
+            return std::ptr::null_mut();
+        }
+        match archive_reader.read_clique_tree(entry_index as usize) {
+            Ok(clique_tree) => Box::into_raw(Box::new(clique_tree)),
+            Err(_) => std::ptr::null_mut(),
+        }
+    }))
+    .unwrap_or(std::ptr::null_mut())
+}
+
+///Get the number of variables of the handle's problem; a solution takes
+/// ceil(tdmk_problem_size(handle) / 64) packed words
+///
+/// # Safety
+/// The handle must have been returned by a tdmk load function and not yet been freed.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_problem_size(handle: *const CliqueTree) -> u64 {
+    match handle.as_ref() {
+        Some(clique_tree) => clique_tree.problem_size() as u64,
+        None => 0,
+    }
+}
+
+///Get the global optimum fitness of the handle's problem
+///
+/// # Safety
+/// The handle must have been returned by a tdmk load function and not yet been freed.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_global_optimum_score(handle: *const CliqueTree) -> f64 {
+    match handle.as_ref() {
+        Some(clique_tree) => clique_tree.glob_optima_score,
+        None => f64::NAN,
+    }
+}
+
+///Calculate the fitness of the packed solution; NaN when the handle or solution is null.
+///Allocation-free and read-only on the handle, so it can be called from any number of threads.
+///
+/// # Safety
+/// The handle must be live and the solution must hold ceil(problem_size / 64) words.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_evaluate(
+    handle: *const CliqueTree,
+    packed_solution: *const u64,
+) -> f64 {
+    let clique_tree = match handle.as_ref() {
+        Some(clique_tree) => clique_tree,
+        None => return f64::NAN,
+    };
+    if packed_solution.is_null() {
+        return f64::NAN;
+    }
+    clique_tree.calculate_fitness_packed_words(words_from_pointer(clique_tree, packed_solution))
+}
+
+///Calculate the fitness the packed solution would have after flipping the variable at the given
+/// index, from the solution's current fitness, touching only the cliques containing that variable.
+///The solution must **not** have been flipped at the index yet; NaN on a null handle or solution.
+///
+/// # Safety
+/// The handle must be live, the solution must hold ceil(problem_size / 64) words and the flipped
+/// variable index must be smaller than the problem size.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_evaluate_delta(
+    handle: *const CliqueTree,
+    packed_solution: *const u64,
+    current_fitness: f64,
+    flipped_variable_index: u64,
+) -> f64 {
+    let clique_tree = match handle.as_ref() {
+        Some(clique_tree) => clique_tree,
+        None => return f64::NAN,
+    };
+    if packed_solution.is_null()
+        || flipped_variable_index as usize >= clique_tree.problem_size()
+    {
+        return f64::NAN;
+    }
+    clique_tree.calculate_fitness_delta_packed_words(
+        words_from_pointer(clique_tree, packed_solution),
+        current_fitness,
+        flipped_variable_index as u32,
+    )
+}
+
+///Determine whether the packed solution with the given fitness is a global optimum;
+/// 1 when it is, 0 when it is not or the handle or solution is null
+///
+/// # Safety
+/// The handle must be live and the solution must hold ceil(problem_size / 64) words.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_is_global_optimum(
+    handle: *const CliqueTree,
+    packed_solution: *const u64,
+    fitness: f64,
+) -> c_int {
+    let clique_tree = match handle.as_ref() {
+        Some(clique_tree) => clique_tree,
+        None => return 0,
+    };
+    if packed_solution.is_null() {
+        return 0;
+    }
+    clique_tree
+        .is_global_optimum_packed_words(words_from_pointer(clique_tree, packed_solution), fitness)
+        as c_int
+}
+
+///Free a handle returned by a tdmk load function; a null handle is ignored
+///
+/// # Safety
+/// The handle must have been returned by a tdmk load function and not yet been freed.
+#[no_mangle]
+pub unsafe extern "C" fn tdmk_free(handle: *mut CliqueTree) {
+    if !handle.is_null() {
+        drop(Box::from_raw(handle));
+    }
+}
@@ -22,3 +22,5 @@ extern crate structopt_derive;
 
 ///The parent module for all the functional modules
 pub mod problem;
+///C ABI for embedding TD Mk Landscape evaluation in non-Rust optimizers
+pub mod ffi;
@@ -1,6 +1,8 @@
+pub mod archive;
 pub mod clique_tree;
 pub mod codomain;
 pub mod codomain_subclasses;
 pub mod configuration;
 pub mod io;
 pub mod problem_generation;
+pub mod stats;
@@ -0,0 +1,272 @@
+/*!
+Module for the single-file archive container that holds all codomain and problem records of a generated
+problem set.
+
+A parameter sweep emits tens of thousands of small files, and on network file systems the per-file
+open/create latency dominates both generation and ingestion. The archive stores the concatenated binary
+codomain and problem records of all instances in one streamable file, followed by an index footer with
+per-instance offsets, so single instances can be accessed randomly without touching the file system
+once per instance.
+*/
+
+use std::convert::TryInto;
+use std::{
+    error::Error,
+    fs::{self, File},
+    io::{BufWriter, Write},
+    path::Path,
+};
+
+use super::clique_tree::{CliqueTree, InputParameters};
+use super::codomain::{decode_codomain_binary, read_binary_field, read_binary_u32, read_binary_u64};
+use super::codomain_subclasses::CodomainFunction;
+use super::problem_generation::{decode_problem_binary, Problem};
+
+///Magic bytes identifying an archive file
+pub const ARCHIVE_MAGIC: &[u8; 8] = b"TDMKARCH";
+///Version of the archive format, bumped on incompatible layout changes
+pub const ARCHIVE_VERSION: u32 = 1;
+
+///One instance in the archive index: its name (the file stem the instance would have had as separate
+/// files) and the offsets and lengths of its codomain and problem records within the archive
+#[derive(Debug, Clone)]
+pub struct ArchiveIndexEntry {
+    pub name: String,
+    pub codomain_offset: u64,
+    pub codomain_length: u64,
+    pub problem_offset: u64,
+    pub problem_length: u64,
+}
+
+///Streaming writer for the archive format:
+/// magic bytes, format version, the concatenated codomain and problem records of all appended
+/// instances, the index footer (number of entries, then per entry the length-prefixed name and the
+/// record offsets and lengths), and finally the footer offset in the trailing 8 bytes.
+///Records are written out as they are appended, so the writer never holds more than the index in memory.
+pub struct ArchiveWriter {
+    buf_writer: BufWriter<File>,
+    entries: Vec<ArchiveIndexEntry>,
+    offset: u64,
+}
+
+impl ArchiveWriter {
+    ///Create the archive file and write the magic bytes and format version
+    pub fn create(file_path: &Path) -> Result<ArchiveWriter, Box<dyn Error>> {
+        let file = File::create(file_path)?;
+        let mut buf_writer = BufWriter::new(file);
+        buf_writer.write_all(ARCHIVE_MAGIC)?;
+        buf_writer.write_all(&ARCHIVE_VERSION.to_le_bytes())?;
+        Ok(ArchiveWriter {
+            buf_writer,
+            entries: Vec::new(),
+            offset: (ARCHIVE_MAGIC.len() + 4) as u64,
+        })
+    }
+
+    ///Append one instance under the given name, as its encoded binary codomain and problem records
+    pub fn append_instance(
+        &mut self,
+        name: &str,
+        codomain_record: &[u8],
+        problem_record: &[u8],
+    ) -> Result<(), Box<dyn Error>> {
+        self.buf_writer.write_all(codomain_record)?;
+        self.buf_writer.write_all(problem_record)?;
+        self.entries.push(ArchiveIndexEntry {
+            name: name.to_owned(),
+            codomain_offset: self.offset,
+            codomain_length: codomain_record.len() as u64,
+            problem_offset: self.offset + codomain_record.len() as u64,
+            problem_length: problem_record.len() as u64,
+        });
+        self.offset += (codomain_record.len() + problem_record.len()) as u64;
+        Ok(())
+    }
+
+    ///Write the index footer and the trailing footer offset, and flush the archive
+    pub fn finish(mut self) -> Result<(), Box<dyn Error>> {
+        let footer_offset = self.offset;
+
+        self.buf_writer
+            .write_all(&(self.entries.len() as u64).to_le_bytes())?;
+        for entry in &self.entries {
+            self.buf_writer
+                .write_all(&(entry.name.len() as u32).to_le_bytes())?;
+            self.buf_writer.write_all(entry.name.as_bytes())?;
+            for value in [
+                entry.codomain_offset,
+                entry.codomain_length,
+                entry.problem_offset,
+                entry.problem_length,
+            ] {
+                self.buf_writer.write_all(&value.to_le_bytes())?;
+            }
+        }
+        self.buf_writer.write_all(&footer_offset.to_le_bytes())?;
+        self.buf_writer.flush()?;
+        Ok(())
+    }
+}
+
+///Reader for the archive format. The file is read once and the index is decoded from the footer;
+/// individual instances are decoded on demand through index-based random access into the record bytes.
+pub struct ArchiveReader {
+    contents: Vec<u8>,
+    entries: Vec<ArchiveIndexEntry>,
+}
+
+impl ArchiveReader {
+    ///Open an archive file and decode its index footer
+    pub fn open(file_path: &Path) -> Result<ArchiveReader, Box<dyn Error>> {
+        let contents = fs::read(file_path)?;
+
+        //Validate the magic bytes and format version
+        if contents.len() < ARCHIVE_MAGIC.len() + 4 + 8
+            || &contents[..ARCHIVE_MAGIC.len()] != ARCHIVE_MAGIC
+        {
+            return Err("File is not an archive file (wrong magic bytes)".into());
+        }
+        let mut offset = ARCHIVE_MAGIC.len();
+        let version = read_binary_u32(
+            &contents,
+            &mut offset,
+            "Archive file is truncated in the format version",
+        )?;
+        if version != ARCHIVE_VERSION {
+            return Err("Unsupported archive format version".into());
+        }
+
+        //The trailing 8 bytes hold the offset of the index footer; the slice cannot fail,
+        // as the length check above guarantees at least 8 trailing bytes
+        let footer_offset =
+            u64::from_le_bytes(contents[contents.len() - 8..].try_into().unwrap()) as usize;
+        if footer_offset >= contents.len() {
+            return Err("Archive index footer offset points outside the file".into());
+        }
+
+        //Decode the index entries; every read is bounds-checked, so a truncated or corrupt
+        // index surfaces as an Err rather than an out-of-bounds slice panic
+        let mut offset = footer_offset;
+        let number_of_entries = read_binary_u64(
+            &contents,
+            &mut offset,
+            "Archive index footer is truncated in the number of entries",
+        )? as usize;
+        //An index entry takes at least 36 bytes, so a plausible entry count is bounded by the
+        // remaining file length; this also keeps a corrupt count from allocating the full capacity
+        if number_of_entries > (contents.len() - offset) / 36 {
+            return Err("Archive index footer declares more entries than the file can hold".into());
+        }
+        let mut entries = Vec::with_capacity(number_of_entries);
+        for _i in 0..number_of_entries {
+            let name_length = read_binary_u32(
+                &contents,
+                &mut offset,
+                "Archive index entry is truncated in the name length",
+            )? as usize;
+            let name = std::str::from_utf8(read_binary_field(
+                &contents,
+                &mut offset,
+                name_length,
+                "Archive index entry is truncated in the name",
+            )?)?
+            .to_owned();
+            let mut values = [0u64; 4];
+            for value in values.iter_mut() {
+                *value = read_binary_u64(
+                    &contents,
+                    &mut offset,
+                    "Archive index entry is truncated in the record offsets",
+                )?;
+            }
+            //Validate the record ranges the entry points at, so the record decoders can slice
+            // them without further checks
+            for record_range in [(values[0], values[1]), (values[2], values[3])] {
+                if record_range
+                    .0
+                    .checked_add(record_range.1)
+                    .map_or(true, |record_end| record_end > contents.len() as u64)
+                {
+                    return Err("Archive index entry points outside the file".into());
+                }
+            }
+            entries.push(ArchiveIndexEntry {
+                name,
+                codomain_offset: values[0],
+                codomain_length: values[1],
+                problem_offset: values[2],
+                problem_length: values[3],
+            });
+        }
+
+        Ok(ArchiveReader { contents, entries })
+    }
+
+    ///Get the number of instances in the archive
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    ///Get the index entries, in the order the instances were appended
+    pub fn entries(&self) -> &[ArchiveIndexEntry] {
+        &self.entries
+    }
+
+    ///Decode the codomain record of the instance at the given index
+    pub fn read_codomain(
+        &self,
+        instance_index: usize,
+    ) -> Result<(CodomainFunction, InputParameters, Vec<f64>), Box<dyn Error>> {
+        let entry = &self.entries[instance_index];
+        decode_codomain_binary(
+            &self.contents[entry.codomain_offset as usize
+                ..(entry.codomain_offset + entry.codomain_length) as usize],
+        )
+    }
+
+    ///Decode the problem record of the instance at the given index
+    pub fn read_problem(&self, instance_index: usize) -> Result<Problem, Box<dyn Error>> {
+        let entry = &self.entries[instance_index];
+        decode_problem_binary(
+            &self.contents[entry.problem_offset as usize
+                ..(entry.problem_offset + entry.problem_length) as usize],
+        )
+    }
+
+    ///Read the clique tree of the instance at the given index from its problem and codomain records,
+    /// the archive counterpart of read_clique_tree_from_files
+    pub fn read_clique_tree(&self, instance_index: usize) -> Result<CliqueTree, Box<dyn Error>> {
+        let problem = self.read_problem(instance_index)?;
+        let (_codomain_function, input_parameters, codomain) = self.read_codomain(instance_index)?;
+        if input_parameters != problem.input_parameters {
+            return Err("Archive instance has mismatching codomain and problem input parameters".into());
+        }
+
+        //The codomain record is flat with stride 2^k; chunk it back into one row per clique
+        let codomain_rows = codomain
+            .chunks(1 << input_parameters.k)
+            .map(|row| row.to_vec())
+            .collect();
+        Ok(CliqueTree::construct_from_problem_codomain(
+            problem,
+            codomain_rows,
+        ))
+    }
+
+    ///Read all clique trees with their instance names, in appended order,
+    /// the archive counterpart of read_clique_trees_paths_from_folders
+    pub fn read_clique_trees_names(&self) -> Result<Vec<(CliqueTree, String)>, Box<dyn Error>> {
+        (0..self.entries.len())
+            .map(|instance_index| {
+                Ok((
+                    self.read_clique_tree(instance_index)?,
+                    self.entries[instance_index].name.clone(),
+                ))
+            })
+            .collect()
+    }
+}
@@ -4,15 +4,23 @@ Module for the 1) Clique Tree construction and global optimum calculation, 2) an
 
 use rand_chacha::ChaChaRng;
 use rand::seq::SliceRandom;
+use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
 
 use std::{error::Error, str::Lines};
 
-use crate::problem::codomain_subclasses::CodomainFunction;
+use crate::problem::stats::{GenerationStage, GenerationStats};
+use crate::problem::codomain_subclasses::{
+    fill_virtual_random_clique_row, virtual_codomain_value, CodomainFunction,
+};
 use crate::problem::problem_generation::Problem;
 
 const FITNESS_EPSILON: f64 = 0.0000000001;
 
+///Number of solutions each parallel batch-evaluation task handles: large enough to amortize the
+/// clique-major traversal per chunk, small enough that the chunk's partial fitnesses stay in cache
+const BATCH_EVALUATION_CHUNK_SIZE: usize = 128;
+
 ///Struct to contain the solution and its fitness, with the solution stored as a vector of u32 values (0 or 1) and the fitness as a f64 value
 #[derive(Debug, Clone)]
 pub struct SolutionFit {
@@ -20,6 +28,99 @@ pub struct SolutionFit {
     pub fitness: f64,
 }
 
+///Bit-packed solution: one bit per variable, stored in u64 words.
+///Bit i lives at bit (i % 64) of word (i / 64), so a solution of N variables takes ceil(N / 64) words
+/// instead of the N u32 values of the unpacked representation.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct PackedSolution {
+    words: Vec<u64>,
+    length: usize,
+}
+
+impl PackedSolution {
+    ///Create an all-zeroes packed solution for the given number of variables
+    pub fn new(length: usize) -> PackedSolution {
+        PackedSolution {
+            words: vec![0; (length + 63) / 64],
+            length,
+        }
+    }
+
+    ///Create a packed solution from the unpacked representation with one u32 (0 or 1) per variable
+    pub fn from_bits(bits: &[u32]) -> PackedSolution {
+        let mut packed = PackedSolution::new(bits.len());
+        for (index, &bit) in bits.iter().enumerate() {
+            packed.set(index, bit);
+        }
+        packed
+    }
+
+    ///Convert the packed solution back to the unpacked representation with one u32 per variable
+    pub fn to_bits(&self) -> Vec<u32> {
+        (0..self.length).map(|index| self.get(index)).collect()
+    }
+
+    ///Get the bit value (0 or 1) of the variable at the given index
+    pub fn get(&self, index: usize) -> u32 {
+        ((self.words[index / 64] >> (index % 64)) & 1) as u32
+    }
+
+    ///Set the bit value (0 or 1) of the variable at the given index
+    pub fn set(&mut self, index: usize, value: u32) {
+        if value == 0 {
+            self.words[index / 64] &= !(1 << (index % 64));
+        } else {
+            self.words[index / 64] |= 1 << (index % 64);
+        }
+    }
+
+    ///Flip the bit of the variable at the given index
+    pub fn flip(&mut self, index: usize) {
+        self.words[index / 64] ^= 1 << (index % 64);
+    }
+
+    ///Get the number of variables in the solution
+    pub fn len(&self) -> usize {
+        self.length
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.length == 0
+    }
+
+    ///Get the underlying u64 words
+    pub fn words(&self) -> &[u64] {
+        &self.words
+    }
+
+    ///Extract the k clique bits for the given clique variable indices, as a substring index
+    /// with the first clique position as the highest bit (same layout as the codomain rows)
+    pub fn extract_clique_substring_index(&self, clique: &[u32]) -> u32 {
+        extract_clique_substring_index_from_words(&self.words, clique)
+    }
+
+    ///Check whether the packed solution is bitwise equal to an unpacked solution
+    pub fn equals_bits(&self, bits: &[u32]) -> bool {
+        self.length == bits.len() && bits.iter().enumerate().all(|(index, &bit)| self.get(index) == bit)
+    }
+}
+
+///Struct to contain a bit-packed solution and its fitness, the packed counterpart of SolutionFit
+#[derive(Debug, Clone)]
+pub struct PackedSolutionFit {
+    pub solution: PackedSolution,
+    pub fitness: f64,
+}
+
+impl From<&SolutionFit> for PackedSolutionFit {
+    fn from(solution_fit: &SolutionFit) -> PackedSolutionFit {
+        PackedSolutionFit {
+            solution: PackedSolution::from_bits(&solution_fit.solution),
+            fitness: solution_fit.fitness,
+        }
+    }
+}
+
 ///Struct to contain the input parameters of the TD Mk Landscape:
 /// Number of cliques/subfunctions M,
 /// size k of each clique/subfunction,
@@ -87,16 +188,329 @@ impl InputParameters {
     }
 }
 
+///Compact product form of the set of global optima.
+///
+///Instead of materializing every global optimum string — of which there can be combinatorially many,
+/// e.g. for NKq instances — we store, per clique and per separator substring index, the set of maximizing
+/// clique-without-separator substring indices found by the dynamic program. Any concrete optimum string is
+/// a choice of one maximizing index per clique that is consistent along the tree edges, so the full set can
+/// be counted exactly and enumerated lazily from O(M * 2^k) storage.
+#[derive(Debug, Clone)]
+pub struct GlobalOptima {
+    ///The global optimum fitness
+    pub score: f64,
+    input_parameters: InputParameters,
+    ///The maximizing k-bit clique substring indices of the root clique
+    root_maximizing_indices: Vec<u32>,
+    ///Per non-root clique, per separator substring index, the maximizing (k-o)-bit
+    /// clique-without-separator substring indices; entry 0 is an empty filler, as the root has no separator
+    clique_maximizing_indices: Vec<Vec<Vec<u32>>>,
+    ///Per non-root clique, the bit shifts that project its parent's clique substring index onto its
+    /// separator substring index; entry 0 is an empty filler
+    separator_projection_shifts: Vec<Vec<u32>>,
+}
+
+impl GlobalOptima {
+    ///Count the exact number of global optima, without enumerating them.
+    ///Per clique and separator instance, the number of optimal subtree completions is the sum over the
+    /// maximizing substring indices of the product of the children's counts, calculated bottom-up.
+    pub fn count(&self) -> u128 {
+        let m = self.input_parameters.m as usize;
+        let k = self.input_parameters.k;
+        let o = self.input_parameters.o;
+
+        //counts[i][j] = the number of optimal completions of the subtree rooted at clique i,
+        // given separator substring index j
+        let mut counts: Vec<Vec<u128>> = self
+            .clique_maximizing_indices
+            .iter()
+            .map(|per_separator| vec![0; per_separator.len()])
+            .collect();
+
+        //Go over all nodes but the root, in reversed order, so that children are processed before their parent
+        for i in (1..m).rev() {
+            for j in 0..counts[i].len() {
+                let mut count_for_separator = 0;
+                for &maximizing_index in &self.clique_maximizing_indices[i][j] {
+                    let clique_substring_index = ((j as u32) << (k - o)) | maximizing_index;
+                    count_for_separator +=
+                        self.count_children_product(i, clique_substring_index, &counts);
+                }
+                counts[i][j] = count_for_separator;
+            }
+        }
+
+        //The total count is the sum over the root's maximizing indices of the children's products
+        self.root_maximizing_indices
+            .iter()
+            .map(|&clique_substring_index| {
+                self.count_children_product(0, clique_substring_index, &counts)
+            })
+            .sum()
+    }
+
+    ///Multiply the counts of the children of the given clique, for the separator substring indices
+    /// projected from the given clique substring index
+    fn count_children_product(
+        &self,
+        clique_index: usize,
+        clique_substring_index: u32,
+        counts: &[Vec<u128>],
+    ) -> u128 {
+        let m = self.input_parameters.m as usize;
+        let b = self.input_parameters.b as usize;
+
+        //Children are created in order, b per parent, so the child indices follow from arithmetic
+        let mut product = 1;
+        for child_index in (clique_index * b + 1)..=(clique_index * b + b) {
+            //Make sure child exists!
+            if child_index >= m {
+                break;
+            }
+            let separator_substring_index = project_separator_index(
+                clique_substring_index,
+                &self.separator_projection_shifts[child_index],
+            );
+            product *= counts[child_index][separator_substring_index as usize];
+        }
+        product
+    }
+
+    ///Visit every global optimum string in turn, reusing one scratch string, so that the memory use
+    /// stays independent of the number of optima
+    pub fn for_each_optimum<F: FnMut(&[u32])>(&self, cliques: &[u32], mut handle_optimum: F) {
+        self.any_optimum(cliques, |optimum| {
+            handle_optimum(optimum);
+            false
+        });
+    }
+
+    ///Visit the global optimum strings until the predicate returns true for one of them,
+    /// and return whether any did. Used for membership tests without materializing the optima.
+    pub fn any_optimum<F: FnMut(&[u32]) -> bool>(&self, cliques: &[u32], mut predicate: F) -> bool {
+        let input_parameters = &self.input_parameters;
+        let problem_size = ((input_parameters.m - 1) * (input_parameters.k - input_parameters.o)
+            + input_parameters.k) as usize;
+
+        //Scratch storage for the string under construction and for the clique substring indices chosen
+        // along the current tree path, which the children project their separator indices from
+        let mut optimum_string = vec![0; problem_size];
+        let mut clique_substring_indices = vec![0; input_parameters.m as usize];
+
+        for &root_index in &self.root_maximizing_indices {
+            //Set the root clique's substring values in the optimum string
+            for position in 0..input_parameters.k as usize {
+                optimum_string[cliques[position] as usize] =
+                    (root_index >> (input_parameters.k as usize - position - 1)) & 1;
+            }
+            clique_substring_indices[0] = root_index;
+            if self.visit_optima(
+                cliques,
+                1,
+                &mut optimum_string,
+                &mut clique_substring_indices,
+                &mut predicate,
+            ) {
+                return true;
+            }
+        }
+        false
+    }
+
+    ///Recursively fill in the maximizing substrings of the clique at the given index and all cliques after it,
+    /// calling the predicate for every completed optimum string. Returns whether the predicate asked to stop.
+    fn visit_optima<F: FnMut(&[u32]) -> bool>(
+        &self,
+        cliques: &[u32],
+        clique_index: usize,
+        optimum_string: &mut Vec<u32>,
+        clique_substring_indices: &mut Vec<u32>,
+        predicate: &mut F,
+    ) -> bool {
+        let input_parameters = &self.input_parameters;
+
+        //If we handled all the cliques, the scratch string holds a complete optimum
+        if clique_index == input_parameters.m as usize {
+            return predicate(optimum_string);
+        }
+
+        let k = input_parameters.k;
+        let o = input_parameters.o;
+        let clique_length = k as usize;
+        let clique = &cliques[clique_index * clique_length..(clique_index + 1) * clique_length];
+
+        //Children are created in order, b per parent, so the parent index follows from arithmetic
+        let parent_index = (clique_index - 1) / input_parameters.b as usize;
+        let separator_substring_index = project_separator_index(
+            clique_substring_indices[parent_index],
+            &self.separator_projection_shifts[clique_index],
+        );
+
+        for &maximizing_index in
+            &self.clique_maximizing_indices[clique_index][separator_substring_index as usize]
+        {
+            clique_substring_indices[clique_index] =
+                (separator_substring_index << (k - o)) | maximizing_index;
+            //Set the clique-without-separator substring values in the optimum string;
+            // the separator values were already set by the ancestor cliques
+            for position in 0..(k - o) as usize {
+                optimum_string[clique[o as usize + position] as usize] =
+                    (maximizing_index >> ((k - o) as usize - position - 1)) & 1;
+            }
+            if self.visit_optima(
+                cliques,
+                clique_index + 1,
+                optimum_string,
+                clique_substring_indices,
+                predicate,
+            ) {
+                return true;
+            }
+        }
+        false
+    }
+
+    ///Decide in O(M) whether the given solution is a global optimum, without enumerating any optima.
+    ///A solution is an optimum exactly when, for every clique, its clique-without-separator substring
+    /// index is one of the maximizing indices for the separator substring the solution induces.
+    pub fn contains(&self, cliques: &[u32], solution: &[u32]) -> bool {
+        self.contains_by(cliques, solution.len(), |clique| {
+            clique.iter().fold(0, |clique_substring_index, &variable_index| {
+                (clique_substring_index << 1) | solution[variable_index as usize]
+            })
+        })
+    }
+
+    ///Decide in O(M) whether the given bit-packed solution is a global optimum; see `contains`
+    pub fn contains_packed(&self, cliques: &[u32], solution: &PackedSolution) -> bool {
+        self.contains_by(cliques, solution.len(), |clique| {
+            solution.extract_clique_substring_index(clique)
+        })
+    }
+
+    ///Decide in O(M) whether the solution given as raw packed words of the stated length is a
+    /// global optimum; see `contains`
+    pub fn contains_packed_words(
+        &self,
+        cliques: &[u32],
+        words: &[u64],
+        solution_length: usize,
+    ) -> bool {
+        self.contains_by(cliques, solution_length, |clique| {
+            extract_clique_substring_index_from_words(words, clique)
+        })
+    }
+
+    ///Shared membership test over a closure that extracts a clique's substring index from the solution
+    fn contains_by<F: Fn(&[u32]) -> u32>(
+        &self,
+        cliques: &[u32],
+        solution_length: usize,
+        extract_substring_index: F,
+    ) -> bool {
+        let input_parameters = &self.input_parameters;
+        let k = input_parameters.k;
+        let o = input_parameters.o;
+        let clique_length = k as usize;
+        let problem_size = ((input_parameters.m - 1) * (k - o) + k) as usize;
+        if solution_length != problem_size {
+            return false;
+        }
+
+        //The root clique has no separator, so its full k-bit substring index must be maximizing
+        let root_index = extract_substring_index(&cliques[0..clique_length]);
+        if self.root_maximizing_indices.binary_search(&root_index).is_err() {
+            return false;
+        }
+
+        //For every other clique, split its substring index into the separator part (the high o bits,
+        // as construct places the separator variables first) and the clique-without-separator part,
+        // and check the latter against the maximizing indices for that separator instance.
+        //The maximizing indices are pushed in ascending order by the dynamic program, so we can binary search.
+        for clique_index in 1..input_parameters.m as usize {
+            let clique_substring_index = extract_substring_index(
+                &cliques[clique_index * clique_length..(clique_index + 1) * clique_length],
+            );
+            let separator_substring_index = clique_substring_index >> (k - o);
+            let maximizing_index = clique_substring_index & ((1 << (k - o)) - 1);
+            if self.clique_maximizing_indices[clique_index][separator_substring_index as usize]
+                .binary_search(&maximizing_index)
+                .is_err()
+            {
+                return false;
+            }
+        }
+        true
+    }
+
+    ///Materialize all global optimum strings. Only use this when the count is known to be manageable.
+    pub fn enumerate(&self, cliques: &[u32]) -> Vec<Vec<u32>> {
+        let mut optima_strings = Vec::new();
+        self.for_each_optimum(cliques, |optimum| optima_strings.push(optimum.to_vec()));
+        optima_strings
+    }
+}
+
+///Reusable scratch memory for the global optimum dynamic program.
+///
+///The DP table is kept as one flat score array indexed by clique * 2^o + separator substring index,
+/// with the tying maximizing indices of all slots concatenated in one side list addressed through
+/// per-slot (start, length) ranges — three contiguous allocations in total, instead of the
+/// M * 2^o separate tie vectors a nested table needs before any work starts.
+///Create it once and pass it to the `_with_scratch` entry points when generating instances in a
+/// loop, so the buffers are reused instead of reallocated per instance.
+#[derive(Debug, Default)]
+pub struct OptimaCalculationScratch {
+    ///Best score per (clique, separator substring index) slot
+    best_scores: Vec<f64>,
+    ///The maximizing clique-without-separator substring indices of all slots, concatenated
+    tie_indices: Vec<u32>,
+    ///Per slot, the (start, length) range of its maximizing indices within `tie_indices`
+    tie_ranges: Vec<(u32, u32)>,
+}
+
+impl OptimaCalculationScratch {
+    pub fn new() -> OptimaCalculationScratch {
+        OptimaCalculationScratch::default()
+    }
+
+    ///Clear the buffers and size the per-slot arrays for a tree with the given number of slots,
+    /// keeping the underlying allocations
+    fn reset(&mut self, number_of_slots: usize) {
+        self.best_scores.clear();
+        self.best_scores.resize(number_of_slots, 0.0);
+        self.tie_indices.clear();
+        self.tie_ranges.clear();
+        self.tie_ranges.resize(number_of_slots, (0, 0));
+    }
+}
+
 #[repr(C)]
 #[derive(Debug)]
 ///The CliqueTree struct with properties input parameters, clique variable indices, the used codomain function, codomain values, global optimum strings and score
+///
+///The cliques and codomain values are stored flat, as every clique has exactly k variable indices
+/// and every codomain row exactly 2^k values: clique i occupies `cliques[i * k..(i + 1) * k]`
+/// and its codomain row occupies `codomain_values[i * 2^k..(i + 1) * 2^k]`.
+///Use the `clique` and `codomain_row`/`codomain_value` accessors instead of indexing by hand.
 pub struct CliqueTree {
     pub input_parameters: InputParameters,
     pub codomain_function: CodomainFunction,
-    pub cliques: Vec<Vec<u32>>,
-    pub codomain_values: Vec<Vec<f64>>,
+    pub cliques: Vec<u32>,
+    pub codomain_values: Vec<f64>,
+    ///The materialized global optimum strings. Only populated when the tree is reconstructed from a
+    /// problem file; freshly generated trees keep the optima in the compact `global_optima` product form
+    /// instead, as the number of optima can explode combinatorially
     pub glob_optima_strings: Vec<Vec<u32>>,
     pub glob_optima_score: f64,
+    ///The global optima in compact product form, set when the optima were calculated by this tree
+    pub global_optima: Option<GlobalOptima>,
+    ///Inverted index from variable index to the (clique index, position in clique) pairs it occurs in,
+    /// so that single-bit delta evaluations only touch the cliques containing the flipped variable
+    pub variable_to_cliques: Vec<Vec<(u32, u32)>>,
+    ///Full-fitness evaluation kernel, selected once at construction: a compile-time specialized
+    /// version for the common clique sizes, or the generic loop for any other k
+    fitness_kernel: fn(&CliqueTree, &[u32]) -> f64,
 }
 
 impl CliqueTree {
@@ -105,69 +519,241 @@ impl CliqueTree {
         codomain_function: CodomainFunction,
         codomain_values: Vec<Vec<f64>>,
         rng: &mut ChaChaRng,
+    ) -> CliqueTree {
+        CliqueTree::new_with_scratch(
+            input_parameters,
+            codomain_function,
+            codomain_values,
+            rng,
+            &mut OptimaCalculationScratch::new(),
+        )
+    }
+
+    ///Create a new clique tree, reusing the passed scratch memory for the optimum calculation;
+    /// the constructor for instance-generation loops
+    pub fn new_with_scratch(
+        input_parameters: InputParameters,
+        codomain_function: CodomainFunction,
+        codomain_values: Vec<Vec<f64>>,
+        rng: &mut ChaChaRng,
+        scratch: &mut OptimaCalculationScratch,
+    ) -> CliqueTree {
+        //Flatten the codomain rows into the stride-2^k layout
+        let codomain_values: Vec<f64> = codomain_values.into_iter().flatten().collect();
+        CliqueTree::new_with_flat_codomain_and_scratch(
+            input_parameters,
+            codomain_function,
+            codomain_values,
+            rng,
+            scratch,
+        )
+    }
+
+    ///Create a new clique tree from codomain values that are already in the flat stride-2^k layout,
+    /// so that e.g. the binary codomain reader's output can back the codomain storage without copying
+    pub fn new_with_flat_codomain(
+        input_parameters: InputParameters,
+        codomain_function: CodomainFunction,
+        codomain_values: Vec<f64>,
+        rng: &mut ChaChaRng,
+    ) -> CliqueTree {
+        CliqueTree::new_with_flat_codomain_and_scratch(
+            input_parameters,
+            codomain_function,
+            codomain_values,
+            rng,
+            &mut OptimaCalculationScratch::new(),
+        )
+    }
+
+    ///Flat-codomain constructor with reusable optimum-calculation scratch memory
+    pub fn new_with_flat_codomain_and_scratch(
+        input_parameters: InputParameters,
+        codomain_function: CodomainFunction,
+        codomain_values: Vec<f64>,
+        rng: &mut ChaChaRng,
+        scratch: &mut OptimaCalculationScratch,
+    ) -> CliqueTree {
+        CliqueTree::new_with_flat_codomain_scratch_and_stats(
+            input_parameters,
+            codomain_function,
+            codomain_values,
+            rng,
+            scratch,
+            &mut GenerationStats::disabled(),
+        )
+    }
+
+    ///Flat-codomain constructor that also records the tree construction and the optimum
+    /// calculation as separate stages in the passed generation stats
+    pub fn new_with_flat_codomain_scratch_and_stats(
+        input_parameters: InputParameters,
+        codomain_function: CodomainFunction,
+        codomain_values: Vec<f64>,
+        rng: &mut ChaChaRng,
+        scratch: &mut OptimaCalculationScratch,
+        stats: &mut GenerationStats,
     ) -> CliqueTree {
         //Create a new clique tree (as its cliques and separators)
+        let stage_start = stats.stage_start();
         let (cliques, separators) = CliqueTree::construct(&input_parameters, rng);
+        stats.record_stage(GenerationStage::TreeConstruction, stage_start);
 
-        //Then calculate the global optimum (optima) for the clique tree
-        let global_opt_tuples = CliqueTree::calculate_global_optima(
+        //Then calculate the global optima for the clique tree, in compact product form
+        let stage_start = stats.stage_start();
+        let global_optima = CliqueTree::calculate_global_optima_product_with_scratch(
             &input_parameters,
             &codomain_function,
             &codomain_values,
             &cliques,
             &separators,
+            scratch,
         );
+        stats.record_stage(GenerationStage::OptimaCalculation, stage_start);
+        if stats.is_enabled() {
+            stats.record_instance(global_optima.count());
+        }
+
+        let glob_optima_score = global_optima.score;
 
-        let glob_optima_score = global_opt_tuples[0].1;
-        let glob_optima_strings = global_opt_tuples.into_iter().map(|tuple| tuple.0).collect();
+        let variable_to_cliques = build_variable_to_cliques_index(&input_parameters, &cliques);
 
-        // and return the resulting CliqueTree struct
+        // and return the resulting CliqueTree struct.
+        //The optima strings are not materialized here; they are enumerated lazily from the product form
         CliqueTree {
+            fitness_kernel: select_fitness_kernel(input_parameters.k),
             input_parameters,
             codomain_function,
             cliques,
             codomain_values,
-            glob_optima_strings,
+            glob_optima_strings: Vec::new(),
+            glob_optima_score,
+            global_optima: Some(global_optima),
+            variable_to_cliques,
+        }
+    }
+
+    ///Create a new clique tree whose codomain is the virtual random codomain for the given seed:
+    /// no codomain table is stored, and every value is recomputed on demand from the seed and the
+    /// (clique index, substring index) pair.
+    ///The passed rng only drives the tree structure; the optimum calculation streams the virtual
+    /// rows one clique at a time, so peak memory stays at one row (O(2^k)) instead of the full
+    /// M * 2^k matrix.
+    pub fn new_virtual(
+        input_parameters: InputParameters,
+        seed: u64,
+        rng: &mut ChaChaRng,
+    ) -> CliqueTree {
+        let codomain_function = CodomainFunction::VirtualRandom { seed };
+
+        //Create a new clique tree (as its cliques and separators)
+        let (cliques, separators) = CliqueTree::construct(&input_parameters, rng);
+
+        //Then calculate the global optima, with the codomain rows computed on the fly
+        let k = input_parameters.k;
+        let global_optima = CliqueTree::calculate_global_optima_product_with_rows(
+            &input_parameters,
+            &codomain_function,
+            |clique_index, row| {
+                fill_virtual_random_clique_row(k, seed, clique_index as u32, row)
+            },
+            &cliques,
+            &separators,
+            &mut OptimaCalculationScratch::new(),
+        );
+
+        let glob_optima_score = global_optima.score;
+
+        let variable_to_cliques = build_variable_to_cliques_index(&input_parameters, &cliques);
+
+        CliqueTree {
+            fitness_kernel: select_fitness_kernel(input_parameters.k),
+            input_parameters,
+            codomain_function,
+            cliques,
+            codomain_values: Vec::new(),
+            glob_optima_strings: Vec::new(),
             glob_optima_score,
+            global_optima: Some(global_optima),
+            variable_to_cliques,
         }
     }
 
     ///Construct the clique tree from the problem struct and codomain values
     pub fn construct_from_problem_codomain(problem: Problem, codomain: Vec<Vec<f64>>) -> Self {
+        let cliques: Vec<u32> = problem.cliques.into_iter().flatten().collect();
+        let variable_to_cliques =
+            build_variable_to_cliques_index(&problem.input_parameters, &cliques);
         CliqueTree {
+            fitness_kernel: select_fitness_kernel(problem.input_parameters.k),
             input_parameters: problem.input_parameters,
             codomain_function: CodomainFunction::Unknown,
-            cliques: problem.cliques,
-            codomain_values: codomain,
+            cliques,
+            codomain_values: codomain.into_iter().flatten().collect(),
             glob_optima_strings: problem.glob_optima_strings,
             glob_optima_score: problem.glob_optima_score,
+            global_optima: None,
+            variable_to_cliques,
+        }
+    }
+
+    ///Get the variable indices of the clique at the given index, as a slice into the flat clique storage
+    pub fn clique(&self, clique_index: usize) -> &[u32] {
+        let k = self.input_parameters.k as usize;
+        &self.cliques[clique_index * k..(clique_index + 1) * k]
+    }
+
+    ///Get the codomain row of the clique at the given index, as a slice into the flat codomain storage
+    pub fn codomain_row(&self, clique_index: usize) -> &[f64] {
+        let row_length = 1 << self.input_parameters.k;
+        &self.codomain_values[clique_index * row_length..(clique_index + 1) * row_length]
+    }
+
+    ///Get the codomain value of the clique at the given index, for the given substring index.
+    ///For a virtual random codomain the value is recomputed from the seed and the indices,
+    /// as no table is stored
+    pub fn codomain_value(&self, clique_index: usize, substring_index: usize) -> f64 {
+        if let CodomainFunction::VirtualRandom { seed } = self.codomain_function {
+            return virtual_codomain_value(seed, clique_index as u32, substring_index as u32);
         }
+        self.codomain_values[clique_index * (1 << self.input_parameters.k) + substring_index]
+    }
+
+    ///Get the number of cliques in the tree
+    pub fn number_of_cliques(&self) -> usize {
+        self.input_parameters.m as usize
     }
 
-    ///Calculate the global optimum for a separable problem
-    fn calculate_global_optimum_separable(
+    ///Calculate the global optimum for a separable problem, with the codomain rows pulled in
+    /// one clique at a time through the passed row provider
+    fn calculate_global_optimum_separable_with_rows<F>(
         input_parameters: &InputParameters,
-        codomain_values: &[Vec<f64>],
-        cliques: &[Vec<u32>],
-    ) -> Vec<(Vec<u32>, f64)> {
+        mut fill_codomain_row: F,
+    ) -> GlobalOptima
+    where
+        F: FnMut(usize, &mut Vec<f64>),
+    {
         //Set score to 0 and glob_optimum string to all zeroes.
         let mut glob_opt_score = 0.0;
 
         //Store the optimas per clique. The optima are stored as a number whose bit representation is the actual solution substring.
         let mut clique_optimas = Vec::with_capacity(input_parameters.m as usize);
 
-        let mut number_global_optima_strings = 1;
+        //Scratch row, reused for every clique
+        let mut codomain_row = Vec::with_capacity((1 << input_parameters.k) as usize);
 
         //Go over all 'cliques/subfunctions'
         for i in 0..input_parameters.m {
+            fill_codomain_row(i as usize, &mut codomain_row);
+
             //Set the current highest score for this subfunction to the string with all zeroes.
-            let mut highest_score = codomain_values[i as usize][0];
+            let mut highest_score = codomain_row[0];
             let mut highest_score_indices = vec![0];
 
             //Go over the rest of the possible permutations of the string.
             for j in 1..(1 << input_parameters.k) as usize {
                 //And determine whether they have a higher score
-                let score = codomain_values[i as usize][j as usize];
+                let score = codomain_row[j];
                 if is_equal_fitness(score, highest_score) {
                     highest_score_indices.push(j as u32);
                 } else if is_better_fitness(score, highest_score) {
@@ -180,100 +766,123 @@ impl CliqueTree {
             //Add the highest score to the global optimum score
             glob_opt_score += highest_score;
 
-            //Calculate the number of global optima
-            number_global_optima_strings *= highest_score_indices.len() as u32;
             //And push this clique's optima to the clique_optima list
             clique_optimas.push(highest_score_indices);
         }
 
-        //Construct the global optima strings. First reserve space equal to the number of global optima, then add a first element.
-        let mut result_optima_strings = Vec::with_capacity(number_global_optima_strings as usize);
-        result_optima_strings.push(vec![0; (input_parameters.m * input_parameters.k) as usize]);
+        //Return the optima in product form. As there is no overlap, every clique has one (empty) separator
+        // instance whose maximizing indices are simply the clique's own optima, and all projections are empty
+        let mut clique_optimas = clique_optimas.into_iter();
+        let root_maximizing_indices = clique_optimas.next().expect("M should be at least 1");
+        let mut clique_maximizing_indices = vec![Vec::new()];
+        clique_maximizing_indices
+            .extend(clique_optimas.map(|highest_score_indices| vec![highest_score_indices]));
+
+        GlobalOptima {
+            score: glob_opt_score,
+            input_parameters: input_parameters.clone(),
+            root_maximizing_indices,
+            clique_maximizing_indices,
+            separator_projection_shifts: vec![Vec::new(); input_parameters.m as usize],
+        }
+    }
 
-        //Construct the global optima
-        CliqueTree::set_optimal_clique_substrings(
+    ///Calculate the global optima strings and fitnesses.
+    ///Note that this materializes every optimum string; use `calculate_global_optima_product` directly
+    /// when the number of optima may be large.
+    pub fn calculate_global_optima(
+        input_parameters: &InputParameters,
+        codomain_function: &CodomainFunction,
+        codomain_values: &[f64],
+        cliques: &[u32],
+        separators: &[Vec<u32>],
+    ) -> Vec<(Vec<u32>, f64)> {
+        let global_optima = CliqueTree::calculate_global_optima_product(
             input_parameters,
+            codomain_function,
+            codomain_values,
             cliques,
-            &mut result_optima_strings,
-            &clique_optimas,
-            0,
+            separators,
         );
-
-        //Return global optima strings and score
-        result_optima_strings
+        let glob_opt_score = global_optima.score;
+        global_optima
+            .enumerate(cliques)
             .into_iter()
-            .map(|optimum| (optimum, glob_opt_score))
+            .map(|glob_opt_string| (glob_opt_string, glob_opt_score))
             .collect()
     }
 
-    ///Construct the global optima, by inserting a clique's optimal substrings into the global optima strings and calling itself recursively for the next clique.
-    ///When there are more than one optimal substrings for a clique, we clone the current global optima and then set all the values.
-    fn set_optimal_clique_substrings(
+    ///Calculate the global optima in compact product form, so that neither the dynamic program
+    /// nor the result ever needs memory proportional to the number of optima
+    pub fn calculate_global_optima_product(
         input_parameters: &InputParameters,
-        cliques: &[Vec<u32>],
-        result_optima_strings: &mut Vec<Vec<u32>>,
-        clique_optimas: &[Vec<u32>],
-        current_index: usize,
-    ) {
-        //If we handled all the cliques, exit.
-        if current_index as u32 == input_parameters.m {
-            return;
-        }
-
-        //Otherwise, first clone the current global optima strings
-        let original_global_optima_length = result_optima_strings.len();
-        //We want to clone (number_clique_optima - 1) times, as we already have one instance.
-        for _ in 0..clique_optimas[current_index].len() - 1 {
-            //clone the global optima
-            for i in 0..original_global_optima_length {
-                result_optima_strings.push(result_optima_strings[i].clone());
-            }
-        }
-
-        //and then set the clique's optimal substrings's values in the global optima strings
-        //Go over all the clique optima
-        for (num, clique_optimum) in clique_optimas[current_index].iter().enumerate() {
-            //And for each, we insert its values into the original global optima.
-            for i in 0..original_global_optima_length {
-                //Insert all its values
-                for j in 0..input_parameters.k {
-                    result_optima_strings[original_global_optima_length * num + i]
-                        [cliques[current_index][j as usize] as usize] =
-                        (clique_optimum >> (input_parameters.k - j - 1)) & 1;
-                }
-            }
-        }
+        codomain_function: &CodomainFunction,
+        codomain_values: &[f64],
+        cliques: &[u32],
+        separators: &[Vec<u32>],
+    ) -> GlobalOptima {
+        CliqueTree::calculate_global_optima_product_with_scratch(
+            input_parameters,
+            codomain_function,
+            codomain_values,
+            cliques,
+            separators,
+            &mut OptimaCalculationScratch::new(),
+        )
+    }
 
-        //Call itself recursively to insert next clique's optimal values
-        CliqueTree::set_optimal_clique_substrings(
+    ///Calculate the global optima in compact product form, reusing the passed scratch memory for
+    /// the DP table, so that instance-generation loops do not reallocate it per instance
+    pub fn calculate_global_optima_product_with_scratch(
+        input_parameters: &InputParameters,
+        codomain_function: &CodomainFunction,
+        codomain_values: &[f64],
+        cliques: &[u32],
+        separators: &[Vec<u32>],
+        scratch: &mut OptimaCalculationScratch,
+    ) -> GlobalOptima {
+        //The stored codomain is flat with stride 2^k, so the row provider just copies out one row
+        let codomain_row_length = (1 << input_parameters.k) as usize;
+        CliqueTree::calculate_global_optima_product_with_rows(
             input_parameters,
+            codomain_function,
+            |clique_index, row| {
+                row.clear();
+                row.extend_from_slice(
+                    &codomain_values
+                        [clique_index * codomain_row_length..(clique_index + 1) * codomain_row_length],
+                );
+            },
             cliques,
-            result_optima_strings,
-            clique_optimas,
-            current_index + 1,
-        );
+            separators,
+            scratch,
+        )
     }
 
-    ///Calculate the global optima strings and fitnesses
-    pub fn calculate_global_optima(
+    ///Calculate the global optima in compact product form, with the codomain rows pulled in one
+    /// clique at a time through the passed row provider, so that the dynamic program also works
+    /// for codomains that are never materialized as a whole (e.g. the virtual random codomain)
+    fn calculate_global_optima_product_with_rows<F>(
         input_parameters: &InputParameters,
         codomain_function: &CodomainFunction,
-        codomain_values: &[Vec<f64>],
-        cliques: &[Vec<u32>],
+        mut fill_codomain_row: F,
+        cliques: &[u32],
         separators: &[Vec<u32>],
-    ) -> Vec<(Vec<u32>, f64)> {
+        scratch: &mut OptimaCalculationScratch,
+    ) -> GlobalOptima
+    where
+        F: FnMut(usize, &mut Vec<f64>),
+    {
         //If the problem is separable, we use a simple optimizer.
         if input_parameters.o == 0 {
-            return CliqueTree::calculate_global_optimum_separable(
+            return CliqueTree::calculate_global_optimum_separable_with_rows(
                 input_parameters,
-                codomain_values,
-                cliques,
+                fill_codomain_row,
             );
         }
 
-        //Capacity set to 2 right now, as I assume the number of global optima is low;
-        // every time there are more than 2 C/S instances with the same score for a given seperator instance,
-        // we will need to allocate memory, which is unwanted. Better be safe than sorry here.
+        //Expected ties per slot: 2 for most functions, as I assume the number of global optima is low;
+        // NKq quantizes scores, so any number of C/S instances can tie for a given separator instance.
         let size_per_separator_instance = if let CodomainFunction::NKq { q: _ } = codomain_function
         {
             1 << (input_parameters.k - input_parameters.o)
@@ -281,18 +890,17 @@ impl CliqueTree {
             2
         };
 
-        // [M][o] = [(best_string1, best_score), (best_string2, best_score)], so it saves the h_i by selecting
-        //   the best strings with their score for each x_a and x_b value
-        //possible TODO: Can't we store the index of the substring instead of the substring, i.e. u32 instead of Vec<u32>?
-        //This should make sure that the inner vectors are initialized
-        let mut best_scores: Vec<Vec<Vec<(Vec<u32>, f64)>>> =
-            vec![
-                vec![
-                    Vec::with_capacity(size_per_separator_instance);
-                    (1 << input_parameters.o) as usize
-                ];
-                input_parameters.m as usize
-            ];
+        //The DP table saves the h_i by selecting the best substrings with their score for each
+        // x_a and x_b value, as one flat score per (clique, separator substring index) slot plus
+        // the concatenated tie list in the scratch arena.
+        //The substrings are stored as plain bit-mask indices into the codomain, instead of materialized bit vectors,
+        // so the whole table stays cache-resident and no per-entry allocation is needed.
+        let number_of_slots =
+            input_parameters.m as usize * (1 << input_parameters.o) as usize;
+        scratch.reset(number_of_slots);
+        scratch
+            .tie_indices
+            .reserve(number_of_slots * size_per_separator_instance);
 
         //Determine number of levels to detect whether a clique has any children, and how to reach that child.
         //Also store the start indices for each level
@@ -313,12 +921,19 @@ impl CliqueTree {
         let mut start_index_current_level = start_index_lowest_level;
         let mut current_level = lowest_level;
 
-        //Calculate all possible substrings, so that we can easily store and retrieve the substrings for the given index.
-        // This way, we don't need to use intermediate representations that use the substrings, but simply an index that points to the substring.
-        let possible_clique_substrings = get_possible_substrings(input_parameters.k);
-        let possible_separator_substrings = get_possible_substrings(input_parameters.o);
-        let possible_clique_without_separator_substrings =
-            get_possible_substrings(input_parameters.k - input_parameters.o);
+        //Number of possible substrings per separator and per clique-without-separator part.
+        //A substring is represented throughout as its bit-mask index: bit (length - 1 - position) of the index
+        // holds the value of the substring at that position, so index arithmetic replaces materialized bit vectors.
+        let number_separator_substrings = (1 << input_parameters.o) as usize;
+        let number_clique_without_separator_substrings =
+            (1 << (input_parameters.k - input_parameters.o)) as usize;
+
+        //Scratch codomain row, refilled by the row provider for every clique
+        let mut codomain_row = Vec::with_capacity((1 << input_parameters.k) as usize);
+
+        //Precompute the substring-index layout, with the per-edge projection of a parent clique
+        // substring index onto a child separator substring index as a dense lookup table.
+        let layout = CliqueTreeLayout::new(input_parameters, cliques, separators);
 
         //Go over all nodes but the root, in reversed order.
         for i in (1..input_parameters.m).rev() {
@@ -328,19 +943,23 @@ impl CliqueTree {
                 start_index_current_level = start_indices[current_level as usize];
             }
 
+            //Pull in this clique's codomain row
+            fill_codomain_row(i as usize, &mut codomain_row);
+
             //Iterate over all possible values for the separator, so that we can calculate h_i(x_a, x_b) for these values (of x_a and x_b).
-            for j in 0..possible_separator_substrings.len() {
-                //Keep track of highest score and the highest scoring Ci/Si values, for these Si values (j)
-                //TODONE: replace this with another value as soon as we allow for multiple global optima. I can make these quite a bit bigger, as it's a small structure.
-                let mut scores = Vec::with_capacity(1 << (input_parameters.k - input_parameters.o));
+            for j in 0..number_separator_substrings {
+                //Keep track of the highest score, with the highest scoring Ci/Si values appended to
+                // the shared tie list from this slot's start offset
+                let slot = i as usize * number_separator_substrings + j;
+                let tie_start = scratch.tie_indices.len();
                 let mut highest_score = 0.0;
                 //Iterate over all possible values for Ci/Si. Store the score in the list if it has a higher score than the current highest score.
-                for k in 0..possible_clique_without_separator_substrings.len() {
+                for k in 0..number_clique_without_separator_substrings {
                     //Calculate f(x_p x_q x_r), which is given by the codomain values passed as input.
                     //I assume codomain is structured [M][k] = score
-                    let mut score = codomain_values[i as usize]
-                        [j * possible_clique_without_separator_substrings.len() + k]; //f
-                                                                                      //Then, if it's a parent, add h_l for each child l.
+                    let mut score =
+                        codomain_row[j * number_clique_without_separator_substrings + k]; //f
+                                                                              //Then, if it's a parent, add h_l for each child l.
                     if i < start_index_lowest_level {
                         let start_index_children = start_indices[(current_level + 1) as usize]
                             + input_parameters.b * (i - start_index_current_level);
@@ -353,45 +972,41 @@ impl CliqueTree {
                             }
                             //Maakt niet uit welke optie we kiezen toch? Want ze hebben allemaal dezelfde score en er hoeft verder nog niet gebrancht te worden,
                             // het enige dat belangrijk is, is dat we de hoogste score selecteren. Toch? Daarna kunnen we aangeven dat er meerdere globale optima zijn.
-                            //Calculate the separator substring values for the current child, from the parent clique substring.
-                            let separator_substring = get_child_separator_substring(
-                                &cliques[i as usize],
-                                &separators[child_index as usize],
-                                &possible_clique_substrings
-                                    [j * possible_clique_without_separator_substrings.len() + k],
-                            );
+                            //Calculate the separator substring index for the current child, from the parent clique substring index,
+                            // as a lookup in the layout's per-edge projection table.
                             //separators shouldn't break here, as we have now inserted a filler for 'separator 0', which doesn't exist,
                             // so everything should be aligned well.
-                            //Add the h_l for this child l to the parent's score, by first transforming into an index variant (easier storage) and
-                            // then retrieving the stored score of the child using the separator substring index.
-                            let separator_substring_index_version =
-                                transform_substring_vector_to_index(&separator_substring);
-                            score += best_scores[child_index as usize]
-                                [separator_substring_index_version as usize][0]
-                                .1;
+                            let separator_substring_index = layout.project_parent_substring_index(
+                                child_index as usize,
+                                layout.clique_substring_index(j, k) as u32,
+                            );
+                            //Add the h_l for this child l to the parent's score, by retrieving the stored score
+                            // of the child using the separator substring index.
+                            score += scratch.best_scores[child_index as usize
+                                * number_separator_substrings
+                                + separator_substring_index as usize];
                             //h_child
                         }
                     }
-                    //store temporarily highest score in scores
+                    //store temporarily highest score in this slot's tie range
                     //This already allows for multiple highest scores
-                    if !scores.is_empty() && is_better_fitness(score, highest_score) {
-                        scores.clear();
+                    if scratch.tie_indices.len() > tie_start && is_better_fitness(score, highest_score)
+                    {
+                        scratch.tie_indices.truncate(tie_start);
                     }
-                    if scores.is_empty() || is_better_or_equal_fitness(score, highest_score) {
-                        //TODO: Here I could store k instead of the substring!
-                        scores.push((
-                            possible_clique_without_separator_substrings[k].clone(),
-                            score,
-                        ));
+                    if scratch.tie_indices.len() == tie_start
+                        || is_better_or_equal_fitness(score, highest_score)
+                    {
+                        //Store the substring as its plain index k; the bits can be extracted with shift/mask when needed.
+                        scratch.tie_indices.push(k as u32);
                         highest_score = score;
                     }
                 }
 
                 //store the highest score into h for that separator (i) and for these values of the separator(j)
-                for tuple in scores.into_iter() {
-                    //This shouldn't break anymore, as we should now have initialized the inner array (j as usize)
-                    best_scores[i as usize][j as usize].push(tuple);
-                }
+                scratch.best_scores[slot] = highest_score;
+                scratch.tie_ranges[slot] =
+                    (tie_start as u32, (scratch.tie_indices.len() - tie_start) as u32);
             }
         }
 
@@ -402,11 +1017,14 @@ impl CliqueTree {
         let mut scores = Vec::with_capacity(1 << input_parameters.k);
         let mut highest_score = 0.0;
 
+        //Pull in the root clique's codomain row
+        fill_codomain_row(0, &mut codomain_row);
+
         //Iterate over all possible clique substrings / values for the root
-        for c in 0..possible_clique_substrings.len() {
+        for c in 0..(1 << input_parameters.k) as usize {
             //I assume codomain is structured [M][k] = score
             //Add f
-            let mut score = codomain_values[0][c as usize]; //f
+            let mut score = codomain_row[c]; //f
 
             //Add the h_l scores for each child l.
             let start_index_children = 1;
@@ -419,19 +1037,14 @@ impl CliqueTree {
                     break;
                 }
 
-                //Calculate the separator substring values for the current child, from the parent clique substring.
-                let separator_substring = get_child_separator_substring(
-                    &cliques[0],
-                    &separators[child_index as usize],
-                    &possible_clique_substrings[c],
-                );
-                //Add the h_l for this child l to the root clique's score, by first transforming into an index variant (easier storage) and
-                // then retrieving the stored score of the child using the separator substring index.
-                let separator_substring_index_version =
-                    transform_substring_vector_to_index(&separator_substring);
-                score += best_scores[child_index as usize]
-                    [separator_substring_index_version as usize][0]
-                    .1;
+                //Calculate the separator substring index for the current child, from the root clique substring index,
+                // as a lookup in the layout's per-edge projection table.
+                let separator_substring_index =
+                    layout.project_parent_substring_index(child_index as usize, c as u32);
+                //Add the h_l for this child l to the root clique's score, by retrieving the stored score
+                // of the child using the separator substring index.
+                score += scratch.best_scores[child_index as usize * number_separator_substrings
+                    + separator_substring_index as usize];
             }
 
             //store temporarily highest score in scores
@@ -440,8 +1053,8 @@ impl CliqueTree {
                 scores.clear();
             }
             if scores.is_empty() || is_better_or_equal_fitness(score, highest_score) {
-                //TODO: Here I could store k instead of the substring!
-                scores.push((possible_clique_substrings[c].clone(), score));
+                //Store the full clique substring as its plain index c.
+                scores.push((c as u32, score));
                 highest_score = score;
             }
         }
@@ -451,193 +1064,207 @@ impl CliqueTree {
             debug!("Best clique0: {:?} with score {:?}", tuple.0, tuple.1);
         }
 
-        //Now we want to construct the global optima string with the score we just calculated.
-        // To construct the global optima, we just need to traverse the tree again, now starting from the top.
-        //possible TODO: Count the number of multiple maximizing instances so that we can make
-        //          an estimate of the number of global optima. I can just use a high number, as the structure is quite small and won't take much space
-
-        let problem_size = (input_parameters.m - 1) * (input_parameters.k - input_parameters.o)
-            + input_parameters.k;
-
-        //initialize string that will store resulting global optimum string to zeroes
-        let mut glob_opt_strings = Vec::with_capacity(40);
-
-        //let mut glob_opt_string = vec![
-        //    0;
-        //    ((input_parameters.M - 1) * (input_parameters.k - input_parameters.o)
-        //        + input_parameters.k) as usize
-        //];
-        //Create vector for global optimum substring for that clique, insert C0 already.
-        //I couuuuld consider storing indices, but then I'd be constantly be translating these values from and to strings...
-        //Only allocate space for the cliques that have a child, as it is temporary storage
-        //let mut clique_opt_substrings =
-        //vec![Vec::new(); (std::cmp::max(start_indices[lowest_level as usize], 1)) as usize];
-        //clique_opt_substrings[0] = scores[0].0.clone();
-
-        //Just take the first tuple of all the choices as the global optimum, ignore other possible global optima for now.
-        //Set C0's global optimum substring values in the global optimum string
-        for clique_opt in &scores {
-            let mut new_glob_opt_string = vec![0; problem_size as usize];
-            for index_in_clique in 0..input_parameters.k as usize {
-                new_glob_opt_string[cliques[0][index_in_clique as usize] as usize] =
-                    clique_opt.0[index_in_clique as usize];
+        for i in 1..input_parameters.m {
+            for j in 0..(1 << input_parameters.o) as usize {
+                let slot = i as usize * number_separator_substrings + j;
+                debug!(
+                    "Best score for clique {:?} for index {:?}: {:?} with score {:?}",
+                    i,
+                    j,
+                    scratch.tie_indices[scratch.tie_ranges[slot].0 as usize],
+                    scratch.best_scores[slot]
+                );
             }
-            glob_opt_strings.push(new_glob_opt_string);
         }
-        //for index_in_clique in 0..input_parameters.k as usize {
-        //    glob_opt_string[cliques[0][index_in_clique as usize] as usize] =
-        //        scores[0].0[index_in_clique as usize];
-        //}
 
-        //Set level and start index to the first clique, as we're starting from the root and iterate to the end
-        start_index_current_level = 0;
-        current_level = 0;
+        //The maximizing substring indices per clique and separator instance, together with the projection
+        // shifts, are exactly the product form of the global optima: any consistent choice of one maximizing
+        // index per clique is an optimum. So we hand them over as-is, instead of traversing the tree and
+        // cloning a full problem-size string for every branching choice like we used to.
+        let glob_opt_score = scores[0].1;
+        let root_maximizing_indices = scores.into_iter().map(|tuple| tuple.0).collect();
+        let clique_maximizing_indices = (0..input_parameters.m as usize)
+            .map(|i| {
+                (0..number_separator_substrings)
+                    .map(|j| {
+                        let (tie_start, tie_length) =
+                            scratch.tie_ranges[i * number_separator_substrings + j];
+                        scratch.tie_indices
+                            [tie_start as usize..(tie_start + tie_length) as usize]
+                            .to_vec()
+                    })
+                    .collect()
+            })
+            .collect();
 
-        //Calculate the end of the loop
-        let mut division = (input_parameters.m - 1) / input_parameters.b;
-        if (input_parameters.m - 1) % input_parameters.b > 0 {
-            division += 1;
+        GlobalOptima {
+            score: glob_opt_score,
+            input_parameters: input_parameters.clone(),
+            root_maximizing_indices,
+            clique_maximizing_indices,
+            separator_projection_shifts: layout.into_projection_shifts(),
         }
+    }
 
-        //Go until latest node/clique with children
-        for i in 0..division {
-            if (current_level as usize) < (start_indices.len() - 1) {
-                //Increase the current level in the tree when the considered index is at the next level's start index
-                if i >= start_indices[(current_level + 1) as usize] {
-                    current_level += 1;
-                    start_index_current_level = start_indices[current_level as usize];
-                }
-
-                //Calculate the start_index for this clique's children
-                let start_index_children = start_indices[(current_level + 1) as usize]
-                    + input_parameters.b * (i - start_index_current_level);
-
-                //Go over all its b children
-                for j in 0..input_parameters.b {
-                    //Break if the index of the child to consider goes out of the M range
-                    if (i * input_parameters.b) + j >= input_parameters.m - 1 {
-                        break;
-                    }
+    ///Calculate the global optima in compact product form, processing the clique tree level by
+    /// level with every level's cliques fanned out over the rayon pool.
+    ///Sibling subtrees are completely independent — a clique's h-table depends only on its own
+    /// subtree — so all cliques of a level can be processed concurrently once the level below is
+    /// done, joining at the root. Every slot computes exactly what the sequential DP computes, so
+    /// the returned product form is identical regardless of the thread count.
+    pub fn calculate_global_optima_product_parallel(
+        input_parameters: &InputParameters,
+        codomain_values: &[f64],
+        cliques: &[u32],
+        separators: &[Vec<u32>],
+    ) -> GlobalOptima {
+        //If the problem is separable, we use the simple sequential optimizer; it is one linear scan
+        let codomain_row_length = (1 << input_parameters.k) as usize;
+        if input_parameters.o == 0 {
+            return CliqueTree::calculate_global_optimum_separable_with_rows(
+                input_parameters,
+                |clique_index, row: &mut Vec<f64>| {
+                    row.clear();
+                    row.extend_from_slice(
+                        &codomain_values[clique_index * codomain_row_length
+                            ..(clique_index + 1) * codomain_row_length],
+                    );
+                },
+            );
+        }
 
-                    //Get current considered child's index
-                    let current_child_index = start_index_children + j;
-
-                    //For all current global optimum strings, either fill in the only maximizing instance for this separator instance,
-                    // or clone the global optimum string x times, for the x maximizing instances of this separator instance.
-                    let glob_opt_strings_length = glob_opt_strings.len();
-                    let mut glob_opt_strings_marked_deletion =
-                        Vec::with_capacity(glob_opt_strings_length);
-                    for k in 0..glob_opt_strings_length {
-                        let glob_opt_string = &mut glob_opt_strings[k];
-
-                        //Construct child's separator values using the global string values and the stored indices of the separator.
-                        let separator_substring = get_separator_substring_from_string(
-                            &separators[current_child_index as usize],
-                            glob_opt_string,
-                        );
-
-                        //Get index for that substring, to index into h
-                        let separator_substring_index_version =
-                            transform_substring_vector_to_index(&separator_substring);
-
-                        //For each maximizing instance for the given separator instance, clone the global string and
-                        // set the maximizing instance values. These maximizing instance values are retrieved from h
-                        //Get best tuple for that child's separator values from h:
-                        let c_without_s_substrings: Vec<&Vec<u32>> = (&best_scores
-                            [current_child_index as usize]
-                            [separator_substring_index_version as usize])
-                            .iter()
-                            .map(|tuple| &tuple.0)
-                            .collect();
-
-                        //Remove the item currently in consideration? (check if loops don't break then)
-                        // Then clone it a number of times equal to the number of maximizing instances for this separator,
-                        //  and assign the bits from the maximizing instances.
-
-                        //If there is just one maximizing instance for this seperator,
-                        // then just insert the values for this instance into the current global optimum string
-                        let number_maximizing_instances = c_without_s_substrings.len();
-                        if number_maximizing_instances == 1 {
-                            //Insert Ci/Si values into global optimum string
-                            for index in 0..(input_parameters.k - input_parameters.o) {
-                                glob_opt_string[cliques[current_child_index as usize]
-                                    [(index + input_parameters.o) as usize]
-                                    as usize] = c_without_s_substrings[0][index as usize];
-                            }
-                        } else {
-                            //otherwise, clone the global optimum under consideration x times, where x is equal to the number of maximizing instances
-                            // for this clique.
-
-                            // make sure there are more than 0 maximizing instances
-                            assert_ne!(
-                                number_maximizing_instances, 0,
-                                "there are 0 maximizing instances, which is impossible"
-                            );
+        let m = input_parameters.m as usize;
+        let b = input_parameters.b as usize;
+        let number_separator_substrings = (1 << input_parameters.o) as usize;
+        let number_clique_without_separator_substrings =
+            (1 << (input_parameters.k - input_parameters.o)) as usize;
 
-                            //direct naar glob_opt_strings pushen ipv eerst naar nieuwe array? -> Dit kan niet, doordat we nog een mutable borrow in scope hebben
-                            //Clone the global optimum string under consideration and add to vector
-                            let mut new_glob_opt_strings =
-                                Vec::with_capacity(number_maximizing_instances);
-                            for _l in 0..number_maximizing_instances {
-                                new_glob_opt_strings.push(glob_opt_string.clone());
-                            }
+        let layout = CliqueTreeLayout::new(input_parameters, cliques, separators);
 
-                            //For each maximizing instance, write the maximizing values to one of the cloned global optimum strings
-                            for (num, maximizing_instance) in
-                                c_without_s_substrings.iter().enumerate()
-                            {
-                                for index in 0..(input_parameters.k - input_parameters.o) {
-                                    new_glob_opt_strings[num][cliques[current_child_index as usize]
-                                        [(index + input_parameters.o) as usize]
-                                        as usize] = maximizing_instance[index as usize];
+        //Start index of every level of the b-ary tree
+        let mut sum = 0;
+        let mut level = 0;
+        let mut start_indices = Vec::new();
+        while sum < input_parameters.m {
+            start_indices.push(sum as usize);
+            sum += input_parameters.b.pow(level);
+            level += 1;
+        }
+        let number_of_levels = start_indices.len();
+
+        let mut best_scores = vec![0.0f64; m * number_separator_substrings];
+        let mut clique_maximizing_indices: Vec<Vec<Vec<u32>>> = vec![Vec::new(); m];
+        //Entry 0 is the empty filler, as the root has no separator
+        clique_maximizing_indices[0] = vec![Vec::new(); number_separator_substrings];
+
+        //Process the levels bottom-up; within a level the slot score arrays are disjoint chunks
+        // and the children's scores of the level below are only read
+        for level in (1..number_of_levels).rev() {
+            let level_start = start_indices[level];
+            let level_end = if level + 1 < number_of_levels {
+                start_indices[level + 1]
+            } else {
+                m
+            };
+
+            let (head, children_scores) =
+                best_scores.split_at_mut(level_end * number_separator_substrings);
+            let current_level_scores = &mut head[level_start * number_separator_substrings..];
+            let children_scores_offset = level_end * number_separator_substrings;
+
+            clique_maximizing_indices[level_start..level_end]
+                .par_iter_mut()
+                .zip(current_level_scores.par_chunks_mut(number_separator_substrings))
+                .enumerate()
+                .for_each(|(level_offset, (clique_ties, slot_scores))| {
+                    let i = level_start + level_offset;
+                    let codomain_row =
+                        &codomain_values[i * codomain_row_length..(i + 1) * codomain_row_length];
+
+                    *clique_ties = (0..number_separator_substrings)
+                        .map(|j| {
+                            let mut ties = Vec::with_capacity(2);
+                            let mut highest_score = 0.0;
+                            for k in 0..number_clique_without_separator_substrings {
+                                let mut score =
+                                    codomain_row[j * number_clique_without_separator_substrings + k]; //f
+                                //If this clique has children, add their h scores
+                                if level + 1 < number_of_levels {
+                                    let start_index_children =
+                                        start_indices[level + 1] + b * (i - level_start);
+                                    for child_index in
+                                        start_index_children..(start_index_children + b)
+                                    {
+                                        if child_index >= m {
+                                            break;
+                                        }
+                                        let separator_substring_index = layout
+                                            .project_parent_substring_index(
+                                                child_index,
+                                                layout.clique_substring_index(j, k) as u32,
+                                            );
+                                        score += children_scores[child_index
+                                            * number_separator_substrings
+                                            + separator_substring_index as usize
+                                            - children_scores_offset];
+                                    }
+                                }
+                                if !ties.is_empty() && is_better_fitness(score, highest_score) {
+                                    ties.clear();
+                                }
+                                if ties.is_empty()
+                                    || is_better_or_equal_fitness(score, highest_score)
+                                {
+                                    ties.push(k as u32);
+                                    highest_score = score;
                                 }
                             }
+                            slot_scores[j] = highest_score;
+                            ties
+                        })
+                        .collect();
+                });
+        }
 
-                            //Append the newly created global optimum strings to the global optimum strings vector,
-                            // and mark the global optimum string currenly under consideration as to be deleted.
-                            glob_opt_strings.append(&mut new_glob_opt_strings);
-                            glob_opt_strings_marked_deletion.push(k);
-                        }
-                    }
-
-                    //Remove the global optimum strings that were marked as to be deleted,
-                    // in reversed order, as we want to make sure that the indices correctly point to the strings to be deleted
-                    for marked_index in glob_opt_strings_marked_deletion.into_iter().rev() {
-                        glob_opt_strings.remove(marked_index);
-                    }
+        //Join at the root, which has no separator: one sequential scan over its full clique substrings
+        let mut scores = Vec::with_capacity(1 << input_parameters.k);
+        let mut highest_score = 0.0;
+        for c in 0..(1 << input_parameters.k) as usize {
+            let mut score = codomain_values[c];
+            for child_index in 1..=b {
+                if child_index >= m {
+                    break;
                 }
+                let separator_substring_index =
+                    layout.project_parent_substring_index(child_index, c as u32);
+                score += best_scores
+                    [child_index * number_separator_substrings + separator_substring_index as usize];
             }
-        }
-
-        for i in 1..input_parameters.m {
-            for j in 0..(1 << input_parameters.o) {
-                debug!(
-                    "Best score for clique {:?} for index {:?}: {:?} with score {:?}",
-                    i,
-                    j,
-                    best_scores[i as usize][j as usize][0].0,
-                    best_scores[i as usize][j as usize][0].1
-                );
+            if !scores.is_empty() && is_better_fitness(score, highest_score) {
+                scores.clear();
+            }
+            if scores.is_empty() || is_better_or_equal_fitness(score, highest_score) {
+                scores.push((c as u32, score));
+                highest_score = score;
             }
         }
 
-        let glob_opt_score = scores.swap_remove(0).1;
-        for glob_opt_string in &glob_opt_strings {
-            debug!(
-                "Glob opt string: {:?} and glob opt score: {:?}",
-                glob_opt_string, glob_opt_score
-            );
+        let glob_opt_score = scores[0].1;
+        GlobalOptima {
+            score: glob_opt_score,
+            input_parameters: input_parameters.clone(),
+            root_maximizing_indices: scores.into_iter().map(|tuple| tuple.0).collect(),
+            clique_maximizing_indices,
+            separator_projection_shifts: layout.into_projection_shifts(),
         }
-        //Return the global optimum string and its fitness
-        glob_opt_strings
-            .into_iter()
-            .map(|glob_opt_string| (glob_opt_string, glob_opt_score))
-            .collect()
     }
 
-    ///Construct the clique tree, using the input paramters and the codomain values. It returns a tuple (cliques, separators)
-    pub fn construct(input_parameters: &InputParameters, rng: &mut ChaChaRng) -> (Vec<Vec<u32>>, Vec<Vec<u32>>) {
-        let mut cliques: Vec<Vec<u32>> = Vec::with_capacity(input_parameters.m as usize);
+    ///Construct the clique tree, using the input paramters and the codomain values. It returns a tuple (cliques, separators),
+    /// with the cliques stored flat with stride k (clique i occupies `cliques[i * k..(i + 1) * k]`)
+    pub fn construct(input_parameters: &InputParameters, rng: &mut ChaChaRng) -> (Vec<u32>, Vec<Vec<u32>>) {
+        let clique_length = input_parameters.k as usize;
+        let mut cliques: Vec<u32> =
+            Vec::with_capacity(input_parameters.m as usize * clique_length);
         let mut separators: Vec<Vec<u32>> = Vec::with_capacity(input_parameters.m as usize);
 
         //Shuffle the variable indices, so that we don't get an easy tree.
@@ -650,13 +1277,11 @@ impl CliqueTree {
         debug!("{:?}", indices);
 
         //Initialize clique 0, C0, by  just taking the first k variable indices from the list.
-        let mut clique0: Vec<u32> = Vec::with_capacity(input_parameters.k as usize);
         for i in 0..input_parameters.k {
-            clique0.push(indices[i as usize]);
+            cliques.push(indices[i as usize]);
         }
 
-        //Add C0 to the cliques list and add separator 0, S0, to the separator list. (S0 is dummy)
-        cliques.push(clique0);
+        //Add separator 0, S0, to the separator list. (S0 is dummy)
         separators.push(Vec::new()); //filler, there is no separator 0!
 
         //We set the number of currenlty constructed cliques to 1
@@ -688,7 +1313,8 @@ impl CliqueTree {
 
                 //Choose o random variable indices from Ci
                 //Here, we first clone Ci, shuffle it, and push the first o variable indices to the separator.
-                let mut clique_copy = cliques[i as usize].clone();
+                let mut clique_copy =
+                    cliques[i as usize * clique_length..(i as usize + 1) * clique_length].to_vec();
                 clique_copy.shuffle(rng);
 
                 let mut new_separator: Vec<u32> = Vec::with_capacity(input_parameters.o as usize);
@@ -706,19 +1332,18 @@ impl CliqueTree {
                     variables_to_add.push(indices[(start_index + k) as usize]);
                 }
 
-                //Construct new clique for the child, by taking the o variables indices from the separator and
+                //Construct new clique for the child directly in the flat clique storage,
+                // by taking the o variables indices from the separator and
                 // (k - o) variable indices from the variable index list
-                let mut new_clique: Vec<u32> = Vec::with_capacity(input_parameters.o as usize);
                 for k in 0..input_parameters.o {
-                    new_clique.push(new_separator[k as usize]);
+                    cliques.push(new_separator[k as usize]);
                 }
 
                 for k in 0..(input_parameters.k - input_parameters.o) {
-                    new_clique.push(variables_to_add[k as usize]);
+                    cliques.push(variables_to_add[k as usize]);
                 }
 
-                //Add the new clique and separator to the clique and separator list, increase the count of constructed cliques.
-                cliques.push(new_clique);
+                //Add the new separator to the separator list, increase the count of constructed cliques.
                 separators.push(new_separator);
                 count += 1;
             }
@@ -739,46 +1364,127 @@ impl CliqueTree {
         //First set the fitness to the current fitness
         let mut fitness = current_solutionfit.fitness;
 
-        //Then loop over all the cliques
-        for clique_index in 0..self.cliques.len() {
-            let clique = &self.cliques[clique_index];
-            if clique.contains(&index_mutation) {
-                //And for each clique calculate the solution substring for this clique, as an index into an array of these substrings.
-                let mut clique_substring_as_index = 0;
-                //Create variable to conveniently store reference to the current clique in.
-                let clique = &self.cliques[clique_index];
+        //Then loop over only the cliques that contain the mutated variable, using the inverted index
+        for &(clique_index, clique_mutation_index) in
+            &self.variable_to_cliques[index_mutation as usize]
+        {
+            let clique_index = clique_index as usize;
+            let clique_mutation_index = clique_mutation_index as usize;
+            //For each such clique calculate the solution substring for this clique, as an index into an array of these substrings.
+            let mut clique_substring_as_index = 0;
+            //Create variable to conveniently store reference to the current clique in.
+            let clique = self.clique(clique_index);
 
-                //We will store the index in the clique of the bit that will be flipped
-                let mut clique_mutation_index = 0;
+            //Go over each variable index in the clique and for each one, take the bit value from the solution string and add it to the clique substring.
+            for j in (0..clique.len()).rev() {
+                clique_substring_as_index +=
+                    current_solutionfit.solution[clique[j] as usize] << (clique.len() - j - 1);
+            }
 
-                //Go over each variable index in the clique and for each one, take the bit value from the solution string and add it to the clique substring.
-                for j in (0..clique.len()).rev() {
-                    //If the solution index of the considered index is equal to the index of the mutated bit, we store the index (in this clique) for future use.
-                    if clique[j] == index_mutation {
-                        clique_mutation_index = j;
-                    }
+            //Substract the fitness contribution of this clique, as this has been previously added to get to the current fitness.
+            fitness -= self.codomain_value(clique_index, clique_substring_as_index as usize);
+
+            //Now set the bit in the clique's subsolution to the value it would be after mutation.
+            // It looks a bit involved, as we use u32 values.
+            if current_solutionfit.solution[clique[clique_mutation_index] as usize] == 0 {
+                clique_substring_as_index += 1 << (clique.len() - clique_mutation_index - 1);
+            } else {
+                clique_substring_as_index -= 1 << (clique.len() - clique_mutation_index - 1);
+            }
+
+            //Add the fitness contribution of this clique, taking into account the mutation.
+            fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
+
+            //Now we subtracted the old codomain value of this clique and have added the new value.
+        }
+
+        *number_evaluations += 1;
+
+        fitness
+    }
+
+    ///Calculate the fitnesss of a passed solution, through the kernel selected at construction
+    pub fn calculate_fitness(&self, solution: &[u32], number_evaluations: &mut u32) -> f64 {
+        let fitness = (self.fitness_kernel)(self, solution);
+
+        *number_evaluations += 1;
+
+        fitness
+    }
+
+    ///Calculate the fitnesses of a whole population of solutions, traversing clique-major:
+    /// for each clique, its variable indices and codomain row are loaded once and the contribution
+    /// is accumulated into all solutions' partial fitnesses, instead of re-streaming the whole
+    /// cliques and codomain structure through cache once per solution
+    pub fn calculate_fitness_batch(
+        &self,
+        solutions: &[Vec<u32>],
+        number_evaluations: &mut u32,
+    ) -> Vec<f64> {
+        let mut fitnesses = vec![0.0; solutions.len()];
+        self.accumulate_fitness_batch(solutions, &mut fitnesses);
+
+        *number_evaluations += solutions.len() as u32;
+
+        fitnesses
+    }
 
-                    //As we would otherwise do, add all the bits from the solution to the clique's subsolution, to be evaluated hereafter
+    ///Calculate the fitnesses of a whole population in parallel, splitting the population into
+    /// chunks that each get the clique-major traversal of calculate_fitness_batch.
+    ///The chunks are independent and written to disjoint output slices, so the result is identical
+    /// to the sequential batch in any thread order.
+    pub fn calculate_fitness_batch_parallel(
+        &self,
+        solutions: &[Vec<u32>],
+        number_evaluations: &mut u32,
+    ) -> Vec<f64> {
+        let mut fitnesses = vec![0.0; solutions.len()];
+        fitnesses
+            .par_chunks_mut(BATCH_EVALUATION_CHUNK_SIZE)
+            .zip(solutions.par_chunks(BATCH_EVALUATION_CHUNK_SIZE))
+            .for_each(|(fitness_chunk, solution_chunk)| {
+                self.accumulate_fitness_batch(solution_chunk, fitness_chunk)
+            });
+
+        *number_evaluations += solutions.len() as u32;
+
+        fitnesses
+    }
+
+    ///Accumulate every clique's fitness contribution into the partial fitnesses of all passed
+    /// solutions, one clique at a time; the shared clique-major inner loop of the batch evaluators
+    fn accumulate_fitness_batch(&self, solutions: &[Vec<u32>], fitnesses: &mut [f64]) {
+        for clique_index in 0..self.number_of_cliques() {
+            let clique = self.clique(clique_index);
+            for (solution, fitness) in solutions.iter().zip(fitnesses.iter_mut()) {
+                //Gather the clique's solution bits into the clique substring index
+                let mut clique_substring_as_index = 0;
+                for j in (0..clique.len()).rev() {
                     clique_substring_as_index +=
-                        current_solutionfit.solution[clique[j] as usize] << (clique.len() - j - 1);
+                        solution[clique[j] as usize] << (clique.len() - j - 1);
                 }
 
-                //Substract the fitness contribution of this clique, as this has been previously added to get to the current fitness.
-                fitness -= self.codomain_values[clique_index][clique_substring_as_index as usize];
+                *fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
+            }
+        }
+    }
 
-                //Now set the bit in the clique's subsolution to the value it would be after mutation.
-                // It looks a bit involved, as we use u32 values.
-                if current_solutionfit.solution[clique[clique_mutation_index] as usize] == 0 {
-                    clique_substring_as_index += 1 << (clique.len() - clique_mutation_index - 1);
-                } else {
-                    clique_substring_as_index -= 1 << (clique.len() - clique_mutation_index - 1);
-                }
+    ///Calculate the fitness of a passed bit-packed solution
+    pub fn calculate_fitness_packed(
+        &self,
+        solution: &PackedSolution,
+        number_evaluations: &mut u32,
+    ) -> f64 {
+        //First set the fitness to 0.0
+        let mut fitness = 0.0;
 
-                //Add the fitness contribution of this clique, taking into account the mutation.
-                fitness += self.codomain_values[clique_index][clique_substring_as_index as usize];
+        //Then loop over all the cliques, extracting each clique's substring index from the packed words
+        for clique_index in 0..self.number_of_cliques() {
+            let clique_substring_as_index = solution
+                .extract_clique_substring_index(self.clique(clique_index));
 
-                //Now we subtracted the old codomain value of this clique and have added the new value.
-            }
+            //Add the fitness contribution of this clique
+            fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
         }
 
         *number_evaluations += 1;
@@ -786,24 +1492,105 @@ impl CliqueTree {
         fitness
     }
 
-    ///Calculate the fitnesss of a passed solution
-    pub fn calculate_fitness(&self, solution: &[u32], number_evaluations: &mut u32) -> f64 {
-        //First set the fitness to 0.0
+    ///Calculate the fitness of a solution given as raw packed words
+    /// (bit i at bit (i % 64) of word (i / 64), ceil(problem_size / 64) words).
+    ///The zero-allocation entry point behind the C ABI: the words are borrowed from the caller
+    /// and nothing is allocated, so a shared read-only tree can be evaluated from many threads.
+    pub fn calculate_fitness_packed_words(&self, words: &[u64]) -> f64 {
         let mut fitness = 0.0;
+        for clique_index in 0..self.number_of_cliques() {
+            let clique_substring_as_index =
+                extract_clique_substring_index_from_words(words, self.clique(clique_index));
+            fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
+        }
+        fitness
+    }
 
-        //Then loop over all the cliques
-        for clique_index in 0..self.cliques.len() {
-            //And for each clique calculate the solution substring for this clique, as an index into an array of these substrings.
-            let mut clique_substring_as_index = 0;
-            //Create variable to conveniently store reference to the current clique in.
-            let clique = &self.cliques[clique_index];
-            //Go over each variable index in the clique and for each one, take the bit value from the solution string and add it to the clique substring.
-            for j in (0..clique.len()).rev() {
-                clique_substring_as_index += solution[clique[j] as usize] << (clique.len() - j - 1);
-            }
+    ///Calculate the fitness a solution given as raw packed words would have after flipping the
+    /// variable at the given index, from its current fitness; the word-slice counterpart of
+    /// calculate_fitness_delta_packed, used by the C ABI
+    pub fn calculate_fitness_delta_packed_words(
+        &self,
+        words: &[u64],
+        current_fitness: f64,
+        index_mutation: u32,
+    ) -> f64 {
+        let mut fitness = current_fitness;
 
-            //Add the fitness contribution of this clique
-            fitness += self.codomain_values[clique_index][clique_substring_as_index as usize];
+        //Loop over only the cliques that contain the mutated variable, using the inverted index
+        for &(clique_index, clique_mutation_index) in
+            &self.variable_to_cliques[index_mutation as usize]
+        {
+            let clique_index = clique_index as usize;
+            let clique = self.clique(clique_index);
+            let mut clique_substring_as_index =
+                extract_clique_substring_index_from_words(words, clique);
+
+            //Substract the old contribution, flip the mutated bit in the index representation
+            // with a single xor, and add the new contribution
+            fitness -= self.codomain_value(clique_index, clique_substring_as_index as usize);
+            clique_substring_as_index ^= 1 << (clique.len() - clique_mutation_index as usize - 1);
+            fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
+        }
+
+        fitness
+    }
+
+    ///Determine whether the solution given as raw packed words, with the given fitness,
+    /// is a global optimum; the word-slice counterpart of is_global_optimum_packed
+    pub fn is_global_optimum_packed_words(&self, words: &[u64], fitness: f64) -> bool {
+        fitness == self.glob_optima_score
+            || ((self.glob_optima_score - fitness).abs() < FITNESS_EPSILON
+                && match &self.global_optima {
+                    Some(global_optima) => global_optima.contains_packed_words(
+                        &self.cliques,
+                        words,
+                        self.problem_size(),
+                    ),
+                    None => self.glob_optima_strings.iter().any(|optimum| {
+                        optimum.len() == self.problem_size()
+                            && optimum.iter().enumerate().all(|(index, &bit)| {
+                                ((words[index / 64] >> (index % 64)) & 1) as u32 == bit
+                            })
+                    }),
+                })
+    }
+
+    ///Get the number of variables of the problem: (m - 1) * (k - o) + k
+    pub fn problem_size(&self) -> usize {
+        ((self.input_parameters.m - 1) * (self.input_parameters.k - self.input_parameters.o)
+            + self.input_parameters.k) as usize
+    }
+
+    ///Calculate the fitness of a passed bit-packed solution using the knowledge that only one bit will be flipped,
+    /// and given that the solution has **not** been mutated at the given index yet
+    pub fn calculate_fitness_delta_packed(
+        &self,
+        current_solutionfit: &PackedSolutionFit,
+        number_evaluations: &mut u32,
+        index_mutation: u32,
+    ) -> f64 {
+        //First set the fitness to the current fitness
+        let mut fitness = current_solutionfit.fitness;
+
+        //Then loop over only the cliques that contain the mutated variable, using the inverted index
+        for &(clique_index, clique_mutation_index) in
+            &self.variable_to_cliques[index_mutation as usize]
+        {
+            let clique_index = clique_index as usize;
+            let clique = self.clique(clique_index);
+            let mut clique_substring_as_index = current_solutionfit
+                .solution
+                .extract_clique_substring_index(clique);
+
+            //Substract the fitness contribution of this clique, as this has been previously added to get to the current fitness.
+            fitness -= self.codomain_value(clique_index, clique_substring_as_index as usize);
+
+            //Flip the mutated bit in the clique's subsolution; with the index representation this is a single xor.
+            clique_substring_as_index ^= 1 << (clique.len() - clique_mutation_index as usize - 1);
+
+            //Add the fitness contribution of this clique, taking into account the mutation.
+            fitness += self.codomain_value(clique_index, clique_substring_as_index as usize);
         }
 
         *number_evaluations += 1;
@@ -811,6 +1598,35 @@ impl CliqueTree {
         fitness
     }
 
+    ///Check whether the given solution is one of the global optimum strings.
+    ///When the optima are stored in product form, membership is decided in O(M) from the per-clique
+    /// maximizing substring sets, without ever touching enumerated strings;
+    /// otherwise the stored strings are scanned.
+    fn matches_glob_optima_string(&self, solution: &[u32]) -> bool {
+        match &self.global_optima {
+            Some(global_optima) => global_optima.contains(&self.cliques, solution),
+            None => self
+                .glob_optima_strings
+                .iter()
+                .any(|optimum| optimum == solution),
+        }
+    }
+
+    ///Determine whether the passed bit-packed solution is a global optimum
+    pub fn is_global_optimum_packed(&self, solution_fit: &PackedSolutionFit) -> bool {
+        solution_fit.fitness == self.glob_optima_score
+            || ((self.glob_optima_score - solution_fit.fitness).abs() < FITNESS_EPSILON
+                && match &self.global_optima {
+                    Some(global_optima) => {
+                        global_optima.contains_packed(&self.cliques, &solution_fit.solution)
+                    }
+                    None => self
+                        .glob_optima_strings
+                        .iter()
+                        .any(|optimum| solution_fit.solution.equals_bits(optimum)),
+                })
+    }
+
     pub fn is_global_optimum(&self, solution_fit: &SolutionFit) -> bool {
         // if solution_fit.fitness != self.glob_optima_score
         //     && (self.glob_optima_score - solution_fit.fitness).abs() < 0.0000000001
@@ -820,7 +1636,97 @@ impl CliqueTree {
         //     }
         solution_fit.fitness == self.glob_optima_score
             || ((self.glob_optima_score - solution_fit.fitness).abs() < FITNESS_EPSILON
-                && self.glob_optima_strings.contains(&solution_fit.solution))
+                && self.matches_glob_optima_string(&solution_fit.solution))
+    }
+
+    ///Create an incremental evaluator for the passed solution, with the solution's fitness and
+    /// per-clique substring indices computed once up front
+    pub fn incremental_evaluator(&self, solution: &[u32]) -> IncrementalEvaluator<'_> {
+        IncrementalEvaluator::new(self, solution)
+    }
+}
+
+///Incremental evaluation state for a solution that is mutated a few bits at a time, as in crossover
+/// and k-opt moves. The current substring index of every clique is cached (M u32 values), so a move
+/// only XOR-updates the cached indices of the cliques containing flipped variables — found through
+/// the tree's inverted variable index — and sums the codomain deltas. Any small move thus costs
+/// O(affected cliques) instead of a full re-evaluation, with no per-call allocation.
+pub struct IncrementalEvaluator<'a> {
+    clique_tree: &'a CliqueTree,
+    solution: Vec<u32>,
+    ///The cached substring index of each clique under the current solution
+    clique_substring_indices: Vec<u32>,
+    fitness: f64,
+}
+
+impl<'a> IncrementalEvaluator<'a> {
+    ///Create the evaluator from a full pass over the solution: cache every clique's substring index
+    /// and sum the initial fitness
+    pub fn new(clique_tree: &'a CliqueTree, solution: &[u32]) -> IncrementalEvaluator<'a> {
+        let mut clique_substring_indices = Vec::with_capacity(clique_tree.number_of_cliques());
+        let mut fitness = 0.0;
+
+        for clique_index in 0..clique_tree.number_of_cliques() {
+            let clique = clique_tree.clique(clique_index);
+            let mut clique_substring_as_index = 0;
+            for j in (0..clique.len()).rev() {
+                clique_substring_as_index += solution[clique[j] as usize] << (clique.len() - j - 1);
+            }
+            fitness += clique_tree.codomain_value(clique_index, clique_substring_as_index as usize);
+            clique_substring_indices.push(clique_substring_as_index);
+        }
+
+        IncrementalEvaluator {
+            clique_tree,
+            solution: solution.to_vec(),
+            clique_substring_indices,
+            fitness,
+        }
+    }
+
+    ///Apply a move that flips the passed variable indices, updating only the cached substring
+    /// indices of the cliques containing a flipped variable, and return the new fitness.
+    ///Every flipped bit is one xor per containing clique, so overlapping flips within one clique
+    /// compose correctly.
+    pub fn apply_flips(&mut self, flipped_variable_indices: &[u32], number_evaluations: &mut u32) -> f64 {
+        let clique_length = self.clique_tree.input_parameters.k as usize;
+
+        for &variable_index in flipped_variable_indices {
+            self.solution[variable_index as usize] ^= 1;
+
+            for &(clique_index, clique_position) in
+                &self.clique_tree.variable_to_cliques[variable_index as usize]
+            {
+                let clique_index = clique_index as usize;
+
+                //Substract this clique's current contribution, flip the bit in its cached substring
+                // index, and add the new contribution
+                self.fitness -= self.clique_tree.codomain_value(
+                    clique_index,
+                    self.clique_substring_indices[clique_index] as usize,
+                );
+                self.clique_substring_indices[clique_index] ^=
+                    1 << (clique_length - clique_position as usize - 1);
+                self.fitness += self.clique_tree.codomain_value(
+                    clique_index,
+                    self.clique_substring_indices[clique_index] as usize,
+                );
+            }
+        }
+
+        *number_evaluations += 1;
+
+        self.fitness
+    }
+
+    ///Get the fitness of the current solution
+    pub fn fitness(&self) -> f64 {
+        self.fitness
+    }
+
+    ///Get the current solution
+    pub fn solution(&self) -> &[u32] {
+        &self.solution
     }
 }
 
@@ -890,38 +1796,226 @@ pub fn get_possible_substrings(length: u32) -> Vec<Vec<u32>> {
         .collect()
 }
 
-/// Get the separator substring for the child, by taking the string values from the parent clique
-///   for the variable indices both in the parent clique and in the separator  
-fn get_separator_substring_from_string(separator: &[u32], glob_string: &[u32]) -> Vec<u32> {
-    //Get the substring values from the parent clique for the variable indices both in the parent clique and in the separator
-    let mut separator_substring = Vec::with_capacity(separator.len());
-    //For every variable index in the child separator, find the index of that variable index in the parent clique,
-    // and copy that value into the separator substring.
-    for &index in separator {
-        separator_substring.push(glob_string[index as usize]);
-    }
-    separator_substring
-}
-
-/// Get the separator substring for the child, by taking the substring values from the parent clique
-///   for the variable indices both in the parent clique and in the separator  
-fn get_child_separator_substring(
-    clique: &[u32],
-    separator: &[u32],
-    clique_substring: &[u32],
-) -> Vec<u32> {
-    //Get the substring values from the parent clique for the variable indices both in the parent clique and in the separator
-    let mut separator_substring = Vec::with_capacity(separator.len());
-    //For every variable index in the child separator, find the index of that variable index in the parent clique,
-    // and copy that value into the separator substring.
-    for &index in separator {
-        let found_index = clique
+///Select the full-fitness evaluation kernel for the given clique size: a compile-time specialized
+/// kernel for the clique sizes our deployments almost always use, the generic loop otherwise.
+///The selection happens once at construction, so the per-evaluation cost is a single indirect call.
+fn select_fitness_kernel(k: u32) -> fn(&CliqueTree, &[u32]) -> f64 {
+    match k {
+        4 => fitness_kernel_specialized::<4>,
+        5 => fitness_kernel_specialized::<5>,
+        6 => fitness_kernel_specialized::<6>,
+        _ => fitness_kernel_generic,
+    }
+}
+
+///Fitness evaluation kernel specialized over the clique size K at compile time.
+///With K const the gather-the-clique-bits loop is fully unrolled and the substring index
+/// computation stays in registers, instead of looping over a runtime clique length per clique.
+fn fitness_kernel_specialized<const K: usize>(clique_tree: &CliqueTree, solution: &[u32]) -> f64 {
+    let mut fitness = 0.0;
+
+    for clique_index in 0..clique_tree.number_of_cliques() {
+        //Take the clique's variables straight from the flat storage with the compile-time stride
+        let clique = &clique_tree.cliques[clique_index * K..clique_index * K + K];
+
+        //Gather the K solution bits into the clique substring index; bit (K - 1 - j) holds position j
+        let mut clique_substring_as_index = 0;
+        for j in 0..K {
+            clique_substring_as_index += solution[clique[j] as usize] << (K - j - 1);
+        }
+
+        fitness += clique_tree.codomain_value(clique_index, clique_substring_as_index as usize);
+    }
+
+    fitness
+}
+
+///Fitness evaluation kernel for clique sizes without a specialized instantiation,
+/// with the former calculate_fitness loop body
+fn fitness_kernel_generic(clique_tree: &CliqueTree, solution: &[u32]) -> f64 {
+    //First set the fitness to 0.0
+    let mut fitness = 0.0;
+
+    //Then loop over all the cliques
+    for clique_index in 0..clique_tree.number_of_cliques() {
+        //And for each clique calculate the solution substring for this clique, as an index into an array of these substrings.
+        let mut clique_substring_as_index = 0;
+        //Create variable to conveniently store reference to the current clique in.
+        let clique = clique_tree.clique(clique_index);
+        //Go over each variable index in the clique and for each one, take the bit value from the solution string and add it to the clique substring.
+        for j in (0..clique.len()).rev() {
+            clique_substring_as_index += solution[clique[j] as usize] << (clique.len() - j - 1);
+        }
+
+        //Add the fitness contribution of this clique
+        fitness += clique_tree.codomain_value(clique_index, clique_substring_as_index as usize);
+    }
+
+    fitness
+}
+
+///Build the inverted index from variable index to the (clique index, position in clique) pairs it occurs in,
+/// from the flat stride-k clique storage
+fn build_variable_to_cliques_index(
+    input_parameters: &InputParameters,
+    cliques: &[u32],
+) -> Vec<Vec<(u32, u32)>> {
+    let clique_length = input_parameters.k as usize;
+    let problem_size = ((input_parameters.m - 1) * (input_parameters.k - input_parameters.o)
+        + input_parameters.k) as usize;
+
+    //A variable occurs in at most 1 + b cliques (its own clique and the children it is a separator variable of)
+    let mut variable_to_cliques = vec![Vec::new(); problem_size];
+    for (position, &variable) in cliques.iter().enumerate() {
+        variable_to_cliques[variable as usize].push((
+            (position / clique_length) as u32,
+            (position % clique_length) as u32,
+        ));
+    }
+    variable_to_cliques
+}
+
+///Explicit contract of the substring-index layout of a constructed clique tree.
+///`CliqueTree::construct` places the o separator variables first in every non-root clique, and a
+/// clique substring is addressed by its bit-mask index, where bit (length - 1 - position) holds
+/// the value of the variable at that position. Two consequences, which the optimum DP relies on:
+/// the separator substring of a clique occupies the high o bits of its substring index, so a full
+/// clique substring index is `separator_substring_index << (k - o) | remainder_substring_index`,
+/// and projecting a parent clique substring index onto a child's separator substring index is a
+/// fixed permutation of o of the parent's k bits.
+///The layout precomputes that permutation per tree edge as a dense lookup table with one entry
+/// per parent substring index, so the DP loops work on pure integer indices: a projection is one
+/// load instead of an o-step shift-and-mask gather. An alternative row ordering (gray-code, for
+/// cache-friendly neighbor flips in local search) only needs a different table builder behind the
+/// same two index methods.
+pub struct CliqueTreeLayout {
+    input_parameters: InputParameters,
+    ///Per non-root clique, the bit shifts that gather the child's separator substring index out of
+    /// its parent's clique substring index; the compact per-edge form, kept by GlobalOptima
+    separator_projection_shifts: Vec<Vec<u32>>,
+    ///Per non-root clique, the dense table from parent clique substring index to child separator
+    /// substring index; entry 0 is an empty filler, as the root has no separator
+    separator_projection_tables: Vec<Vec<u32>>,
+}
+
+impl CliqueTreeLayout {
+    ///Build the layout of a constructed clique tree.
+    ///Each edge's table is sized like a codomain row, so building the tables is one pass over the
+    /// same index space the DP scans anyway.
+    pub fn new(
+        input_parameters: &InputParameters,
+        cliques: &[u32],
+        separators: &[Vec<u32>],
+    ) -> CliqueTreeLayout {
+        let separator_projection_shifts =
+            compute_separator_projection_shifts(input_parameters, cliques, separators);
+        let separator_projection_tables = separator_projection_shifts
+            .iter()
+            .enumerate()
+            .map(|(child_index, separator_shifts)| {
+                if child_index == 0 {
+                    Vec::new()
+                } else {
+                    (0..1u32 << input_parameters.k)
+                        .map(|parent_substring_index| {
+                            project_separator_index(parent_substring_index, separator_shifts)
+                        })
+                        .collect()
+                }
+            })
+            .collect();
+        CliqueTreeLayout {
+            input_parameters: input_parameters.clone(),
+            separator_projection_shifts,
+            separator_projection_tables,
+        }
+    }
+
+    ///Project a parent clique substring index onto the separator substring index of the passed
+    /// child clique, as a single table lookup
+    #[inline]
+    pub fn project_parent_substring_index(
+        &self,
+        child_index: usize,
+        parent_substring_index: u32,
+    ) -> u32 {
+        self.separator_projection_tables[child_index][parent_substring_index as usize]
+    }
+
+    ///Compose a full clique substring index from a separator substring index and a
+    /// clique-without-separator substring index; the separator occupies the high o bits
+    #[inline]
+    pub fn clique_substring_index(
+        &self,
+        separator_substring_index: usize,
+        remainder_substring_index: usize,
+    ) -> usize {
+        (separator_substring_index << (self.input_parameters.k - self.input_parameters.o))
+            | remainder_substring_index
+    }
+
+    ///Hand the compact per-edge projection shifts over to the product form, which keeps those
+    /// instead of the dense tables so the long-lived GlobalOptima stays small
+    fn into_projection_shifts(self) -> Vec<Vec<u32>> {
+        self.separator_projection_shifts
+    }
+}
+
+///Extract the k clique bits for the given clique variable indices out of raw packed solution words
+/// (bit i at bit (i % 64) of word (i / 64)), as a substring index with the first clique position as
+/// the highest bit (same layout as the codomain rows)
+fn extract_clique_substring_index_from_words(words: &[u64], clique: &[u32]) -> u32 {
+    let mut clique_substring_as_index = 0;
+    for &variable_index in clique {
+        let variable_index = variable_index as usize;
+        clique_substring_as_index = (clique_substring_as_index << 1)
+            | ((words[variable_index / 64] >> (variable_index % 64)) & 1) as u32;
+    }
+    clique_substring_as_index
+}
+
+///Compute, per child clique, the bit shift amounts that project a parent clique substring index
+/// onto the child's separator substring index.
+///The clique/separator layout is fixed after construction, so the positional search through the
+/// parent clique only has to happen once per edge here, instead of once per substring in the DP loops;
+/// the projection itself becomes a shift-and-mask per separator bit.
+///Entry 0 stays empty, as the root has no separator.
+fn compute_separator_projection_shifts(
+    input_parameters: &InputParameters,
+    cliques: &[u32],
+    separators: &[Vec<u32>],
+) -> Vec<Vec<u32>> {
+    let clique_length = input_parameters.k as usize;
+    let mut separator_projection_shifts: Vec<Vec<u32>> =
+        vec![Vec::new(); input_parameters.m as usize];
+    for child_index in 1..input_parameters.m as usize {
+        //Children are created in order, b per parent, so the parent index follows from arithmetic
+        let parent_index = (child_index - 1) / input_parameters.b as usize;
+        let parent_clique =
+            &cliques[parent_index * clique_length..(parent_index + 1) * clique_length];
+        separator_projection_shifts[child_index] = separators[child_index]
             .iter()
-            .position(|&x| x == index)
-            .expect("index in separator not found in clique!");
-        separator_substring.push(clique_substring[found_index]);
+            .map(|&separator_variable| {
+                let found_index = parent_clique
+                    .iter()
+                    .position(|&x| x == separator_variable)
+                    .expect("index in separator not found in clique!");
+                (clique_length - found_index - 1) as u32
+            })
+            .collect();
+    }
+    separator_projection_shifts
+}
+
+/// Project a parent clique substring index onto a child separator substring index,
+///   using the precomputed shift amounts of the separator variables' positions in the parent clique,
+///   with the first separator position ending up as the highest bit
+fn project_separator_index(clique_substring_index: u32, separator_shifts: &[u32]) -> u32 {
+    let mut separator_index = 0;
+    for &shift in separator_shifts {
+        separator_index = (separator_index << 1) | ((clique_substring_index >> shift) & 1);
     }
-    separator_substring
+    separator_index
 }
 
 ///Transform the passed substring into an index(bit value) that would point to that substring
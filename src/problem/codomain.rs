@@ -13,6 +13,7 @@ use super::clique_tree::InputParameters;
 use super::codomain_subclasses::*;
 use super::configuration::{ConfigurationParameters, get_rng};
 
+use std::convert::TryInto;
 use std::fmt::Write as fmtWrite;
 use std::fs::File;
 use std::io::{BufWriter, Write};
@@ -169,19 +170,122 @@ fn handle_input_configuration_file(
     Ok(())
 }
 
-///Generate the codomain and write them to the file
+///Generate the codomain and write them to the file.
+///As the codomain is not needed in memory afterwards, the rows are streamed straight to the writer,
+/// keeping peak memory at O(2^k) instead of O(m * 2^k).
 fn generate_and_write(
     input_parameters: &InputParameters,
     codomain_function: &CodomainFunction,
     output_file_path: &Path,
     rng: &mut ChaChaRng
 ) -> Result<(), Box<dyn Error>> {
-    write_codomain(
-        input_parameters,
-        codomain_function,
-        output_file_path,
-        &generate_codomain(input_parameters, codomain_function, rng),
+    let file = File::create(output_file_path)?;
+    let mut buf_writer = BufWriter::new(file);
+    let mut write_buffer = String::with_capacity(WRITE_BUFFER_FLUSH_SIZE);
+
+    //Write the codomain function on the first line
+    writeln!(write_buffer, "{}", codomain_function)?;
+
+    //Write the input parameters on the second line
+    writeln!(
+        write_buffer,
+        "{} {} {} {}",
+        input_parameters.m, input_parameters.k, input_parameters.o, input_parameters.b
     )?;
+
+    //Generate the codomain one clique row at a time and write each row straight to the buffer
+    generate_codomain_streaming(input_parameters, codomain_function, rng, |row| {
+        for value in row {
+            writeln!(write_buffer, "{}", value)?;
+        }
+        if write_buffer.len() >= WRITE_BUFFER_FLUSH_SIZE {
+            buf_writer.write_all(write_buffer.as_bytes())?;
+            write_buffer.clear();
+        }
+        Ok(())
+    })?;
+    buf_writer.write_all(write_buffer.as_bytes())?;
+
+    //Flush all data still in the buffer
+    buf_writer.flush()?;
+
+    Ok(())
+}
+
+///Generate the codomain one clique row at a time, handing each row to the passed callback.
+///The rows are produced by the same per-clique building blocks as generate_codomain, in the same
+/// RNG order, so streaming and batch generation yield identical values for the same seed;
+/// the difference is only that peak memory stays at one row (O(2^k)) instead of the full matrix.
+pub fn generate_codomain_streaming<F>(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    rng: &mut ChaChaRng,
+    mut handle_row: F,
+) -> Result<(), Box<dyn Error>>
+where
+    F: FnMut(&[f64]) -> Result<(), Box<dyn Error>>,
+{
+    let m = input_parameters.m;
+    let k = input_parameters.k;
+
+    //Ensure k is smaller than 32, as otherwise the bit shift goes out of bounds on 32-bit machines
+    assert!(k < 32);
+
+    let mut row = Vec::with_capacity(1 << k);
+
+    //Per-function scratch state that the batch generators carry between cliques
+    match codomain_function {
+        CodomainFunction::Trap => {
+            //All cliques get the same trap row; compute it once and replay it
+            fill_trap_clique_row(k, 2.5, &mut row);
+            for _ in 0..m {
+                handle_row(&row)?;
+            }
+        }
+        CodomainFunction::NKp { p } => {
+            let mut codomain_clique_indices: Vec<u32> = (0..(1 << k)).collect();
+            let mut no_contribution_mask = Vec::with_capacity(1 << k);
+            for _ in 0..m {
+                fill_nk_p_clique_row(
+                    k,
+                    *p,
+                    rng,
+                    &mut codomain_clique_indices,
+                    &mut no_contribution_mask,
+                    &mut row,
+                );
+                handle_row(&row)?;
+            }
+        }
+        CodomainFunction::VirtualRandom { seed } => {
+            //The values are a pure function of the seed and the indices, not of the passed rng
+            for clique_index in 0..m {
+                fill_virtual_random_clique_row(k, *seed, clique_index, &mut row);
+                handle_row(&row)?;
+            }
+        }
+        CodomainFunction::Random
+        | CodomainFunction::DeceptiveTrap
+        | CodomainFunction::NKq { q: _ }
+        | CodomainFunction::RandomDeceptiveTrap { p_deceptive: _ } => {
+            for _ in 0..m {
+                match codomain_function {
+                    CodomainFunction::Random => fill_random_clique_row(k, rng, &mut row),
+                    CodomainFunction::DeceptiveTrap => {
+                        fill_trap_general_clique_row(k, rng, &mut row)
+                    }
+                    CodomainFunction::NKq { q } => fill_nk_q_clique_row(k, *q, rng, &mut row),
+                    CodomainFunction::RandomDeceptiveTrap { p_deceptive } => {
+                        fill_random_trap_clique_row(k, *p_deceptive, rng, &mut row)
+                    }
+                    _ => unreachable!(),
+                }
+                handle_row(&row)?;
+            }
+        }
+        CodomainFunction::Unknown => panic!("We can't generate codomain for unknown codomain"),
+    }
+
     Ok(())
 }
 
@@ -202,6 +306,24 @@ pub fn generate_write_return(
     Ok(codomain)
 }
 
+///Generate the codomain into the passed flat stride-2^k buffer with clear-and-refill semantics,
+/// so that generation loops reuse one codomain allocation across instances.
+///The rows are produced by the same building blocks in the same RNG order as generate_codomain.
+pub fn generate_codomain_flat_into(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    rng: &mut ChaChaRng,
+    codomain_values: &mut Vec<f64>,
+) -> Result<(), Box<dyn Error>> {
+    codomain_values.clear();
+    codomain_values
+        .reserve((input_parameters.m as usize) << input_parameters.k);
+    generate_codomain_streaming(input_parameters, codomain_function, rng, |row| {
+        codomain_values.extend_from_slice(row);
+        Ok(())
+    })
+}
+
 ///Generate the codomain, by calling the right generation function
 pub fn generate_codomain(
     input_parameters: &InputParameters,
@@ -217,11 +339,23 @@ pub fn generate_codomain(
         CodomainFunction::RandomDeceptiveTrap { p_deceptive } => {
             generate_random_trap(input_parameters, *p_deceptive, rng)
         }
+        CodomainFunction::VirtualRandom { seed } => {
+            generate_virtual_random(input_parameters, *seed)
+        }
         CodomainFunction::Unknown => panic!("We can't generate codomain for unknown codomain"),
     }
 }
 
+///Size at which the formatting buffer of the batched writers is handed to the underlying writer.
+///Large enough that formatting round trips and writer calls stay off the profile,
+/// small enough that writing huge codomains does not hold the whole file in memory.
+pub(crate) const WRITE_BUFFER_FLUSH_SIZE: usize = 4 << 20;
+
 ///Write the codomain to the passed file
+///All values are formatted into one large reusable buffer that is only handed to the writer
+/// when it fills up, instead of one writer call per codomain value.
+///The values are formatted with the standard formatter, so the output stays byte-identical
+/// to what previous versions emitted.
 fn write_codomain(
     input_parameters: &InputParameters,
     codomain_function: &CodomainFunction,
@@ -230,12 +364,10 @@ fn write_codomain(
 ) -> Result<(), Box<dyn Error>> {
     let file = File::create(file_path)?;
     let mut buf_writer = BufWriter::new(file);
-    let mut write_buffer = String::new();
+    let mut write_buffer = String::with_capacity(WRITE_BUFFER_FLUSH_SIZE);
 
     //Write the codomain function on the first line
     writeln!(write_buffer, "{}", codomain_function)?;
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
 
     //Write the input parameters on the second line
     writeln!(
@@ -243,17 +375,58 @@ fn write_codomain(
         "{} {} {} {}",
         input_parameters.m, input_parameters.k, input_parameters.o, input_parameters.b
     )?;
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
 
-    //Write all codomain values on the subsequent lines
+    //Write all codomain values on the subsequent lines, flushing the buffer in large chunks
     for clique in codomain {
         for value in clique {
             writeln!(write_buffer, "{}", value)?;
+            if write_buffer.len() >= WRITE_BUFFER_FLUSH_SIZE {
+                buf_writer.write_all(write_buffer.as_bytes())?;
+                write_buffer.clear();
+            }
+        }
+    }
+    buf_writer.write_all(write_buffer.as_bytes())?;
+
+    //Flush all data still in the buffer
+    buf_writer.flush()?;
+
+    Ok(())
+}
+
+///Write the codomain to the passed file from the flat stride-2^k layout, reusing the passed
+/// formatting buffer; the output is byte-identical to write_codomain
+pub(crate) fn write_codomain_flat(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    file_path: &Path,
+    codomain: &[f64],
+    write_buffer: &mut String,
+) -> Result<(), Box<dyn Error>> {
+    let file = File::create(file_path)?;
+    let mut buf_writer = BufWriter::new(file);
+    write_buffer.clear();
+
+    //Write the codomain function on the first line
+    writeln!(write_buffer, "{}", codomain_function)?;
+
+    //Write the input parameters on the second line
+    writeln!(
+        write_buffer,
+        "{} {} {} {}",
+        input_parameters.m, input_parameters.k, input_parameters.o, input_parameters.b
+    )?;
+
+    //Write all codomain values on the subsequent lines, flushing the buffer in large chunks
+    for value in codomain {
+        writeln!(write_buffer, "{}", value)?;
+        if write_buffer.len() >= WRITE_BUFFER_FLUSH_SIZE {
             buf_writer.write_all(write_buffer.as_bytes())?;
             write_buffer.clear();
         }
     }
+    buf_writer.write_all(write_buffer.as_bytes())?;
+    write_buffer.clear();
 
     //Flush all data still in the buffer
     buf_writer.flush()?;
@@ -261,6 +434,203 @@ fn write_codomain(
     Ok(())
 }
 
+///Magic bytes identifying a binary codomain file
+pub const CODOMAIN_BINARY_MAGIC: &[u8; 8] = b"TDMKCODO";
+///Version of the binary codomain format, bumped on incompatible layout changes
+pub const CODOMAIN_BINARY_VERSION: u32 = 1;
+
+///Read the next `length` bytes of a binary record and advance the offset past them,
+/// returning the passed error instead of panicking when the record is truncated.
+///The binary decoders read every field through this helper, so corrupt or truncated
+/// files surface as an Err rather than an out-of-bounds slice panic.
+pub(crate) fn read_binary_field<'a>(
+    contents: &'a [u8],
+    offset: &mut usize,
+    length: usize,
+    truncation_error: &'static str,
+) -> Result<&'a [u8], Box<dyn Error>> {
+    let field = contents
+        .get(*offset..offset.checked_add(length).ok_or(truncation_error)?)
+        .ok_or(truncation_error)?;
+    *offset += length;
+    Ok(field)
+}
+
+///Read the next little-endian u32 field of a binary record, bounds-checked
+pub(crate) fn read_binary_u32(
+    contents: &[u8],
+    offset: &mut usize,
+    truncation_error: &'static str,
+) -> Result<u32, Box<dyn Error>> {
+    let field = read_binary_field(contents, offset, 4, truncation_error)?;
+    Ok(u32::from_le_bytes(field.try_into().unwrap()))
+}
+
+///Read the next little-endian u64 field of a binary record, bounds-checked
+pub(crate) fn read_binary_u64(
+    contents: &[u8],
+    offset: &mut usize,
+    truncation_error: &'static str,
+) -> Result<u64, Box<dyn Error>> {
+    let field = read_binary_field(contents, offset, 8, truncation_error)?;
+    Ok(u64::from_le_bytes(field.try_into().unwrap()))
+}
+
+///Read the next little-endian f64 field of a binary record, bounds-checked
+pub(crate) fn read_binary_f64(
+    contents: &[u8],
+    offset: &mut usize,
+    truncation_error: &'static str,
+) -> Result<f64, Box<dyn Error>> {
+    let field = read_binary_field(contents, offset, 8, truncation_error)?;
+    Ok(f64::from_le_bytes(field.try_into().unwrap()))
+}
+
+///Write the codomain to the passed file in the binary format:
+/// magic bytes, format version, the codomain function tag (length-prefixed display string),
+/// the input parameters m/k/o/b, and then all m * 2^k codomain values as a dense little-endian f64 array.
+///The codomain values are passed in the flat stride-2^k layout used by CliqueTree.
+///The text format remains available for interop; the binary format exists because parsing
+/// one ASCII float per line dominates experiment startup for large k.
+pub fn write_codomain_binary(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    file_path: &Path,
+    codomain: &[f64],
+) -> Result<(), Box<dyn Error>> {
+    let file = File::create(file_path)?;
+    let mut buf_writer = BufWriter::new(file);
+    buf_writer.write_all(&encode_codomain_binary(
+        input_parameters,
+        codomain_function,
+        codomain,
+    ))?;
+    buf_writer.flush()?;
+
+    Ok(())
+}
+
+///Encode the codomain in the binary format into a byte buffer; the record layout of
+/// write_codomain_binary, usable as an archive record as well as a standalone file
+pub fn encode_codomain_binary(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    codomain: &[f64],
+) -> Vec<u8> {
+    let codomain_function_tag = codomain_function.to_string();
+    let mut encoded =
+        Vec::with_capacity(CODOMAIN_BINARY_MAGIC.len() + 24 + codomain_function_tag.len() + codomain.len() * 8);
+
+    //Write the magic bytes and format version
+    encoded.extend_from_slice(CODOMAIN_BINARY_MAGIC);
+    encoded.extend_from_slice(&CODOMAIN_BINARY_VERSION.to_le_bytes());
+
+    //Write the codomain function tag, length-prefixed
+    encoded.extend_from_slice(&(codomain_function_tag.len() as u32).to_le_bytes());
+    encoded.extend_from_slice(codomain_function_tag.as_bytes());
+
+    //Write the input parameters
+    for parameter in [
+        input_parameters.m,
+        input_parameters.k,
+        input_parameters.o,
+        input_parameters.b,
+    ] {
+        encoded.extend_from_slice(&parameter.to_le_bytes());
+    }
+
+    //Write the dense codomain value array
+    for value in codomain {
+        encoded.extend_from_slice(&value.to_le_bytes());
+    }
+
+    encoded
+}
+
+///Read a binary codomain file as written by write_codomain_binary.
+///The whole file is read in one call and the value array is decoded in a single pass,
+/// returning the codomain values in the flat stride-2^k layout so they can back
+/// CliqueTree::new_with_flat_codomain without further copying.
+pub fn read_codomain_binary(
+    file_path: &Path,
+) -> Result<(CodomainFunction, InputParameters, Vec<f64>), Box<dyn Error>> {
+    let contents = fs::read(file_path)?;
+    decode_codomain_binary(&contents)
+}
+
+///Decode a binary codomain record as encoded by encode_codomain_binary
+pub fn decode_codomain_binary(
+    contents: &[u8],
+) -> Result<(CodomainFunction, InputParameters, Vec<f64>), Box<dyn Error>> {
+    //Validate the magic bytes and format version
+    if contents.len() < CODOMAIN_BINARY_MAGIC.len() + 4
+        || &contents[..CODOMAIN_BINARY_MAGIC.len()] != CODOMAIN_BINARY_MAGIC
+    {
+        return Err("File is not a binary codomain file (wrong magic bytes)".into());
+    }
+    let mut offset = CODOMAIN_BINARY_MAGIC.len();
+    let version = read_binary_u32(
+        contents,
+        &mut offset,
+        "Binary codomain file is truncated in the format version",
+    )?;
+    if version != CODOMAIN_BINARY_VERSION {
+        return Err("Unsupported binary codomain format version".into());
+    }
+
+    //Read the codomain function tag
+    let tag_length = read_binary_u32(
+        contents,
+        &mut offset,
+        "Binary codomain file is truncated in the codomain function tag length",
+    )? as usize;
+    let codomain_function_tag = std::str::from_utf8(read_binary_field(
+        contents,
+        &mut offset,
+        tag_length,
+        "Binary codomain file is truncated in the codomain function tag",
+    )?)?;
+    let mut iter_list = vec![" "];
+    iter_list.extend(codomain_function_tag.split(' '));
+    //from_iter_safe, as from_iter exits the process on an unrecognized tag, which a library
+    // caller (the C ABI in particular) must see as an Err instead
+    let codomain_function = CodomainFunction::from_iter_safe(iter_list)
+        .map_err(|_| "Binary codomain file contains an unrecognized codomain function tag")?;
+
+    //Read the input parameters
+    let mut parameters = [0u32; 4];
+    for parameter in parameters.iter_mut() {
+        *parameter = read_binary_u32(
+            contents,
+            &mut offset,
+            "Binary codomain file is truncated in the input parameters",
+        )?;
+    }
+    let input_parameters = InputParameters::new_from_primitives(
+        parameters[0],
+        parameters[1],
+        parameters[2],
+        parameters[3],
+    );
+
+    //Decode the dense codomain value array; the expected byte count is computed with checked
+    // arithmetic, so implausible input parameters are rejected instead of overflowing
+    let expected_value_bytes = 1usize
+        .checked_shl(input_parameters.k)
+        .and_then(|values_per_clique| values_per_clique.checked_mul(input_parameters.m as usize))
+        .and_then(|number_of_values| number_of_values.checked_mul(8))
+        .ok_or("Binary codomain file declares implausibly large input parameters")?;
+    if contents.len() - offset != expected_value_bytes {
+        return Err("Binary codomain file does not contain the expected number of values".into());
+    }
+    let codomain: Vec<f64> = contents[offset..]
+        .chunks_exact(8)
+        .map(|bytes| f64::from_le_bytes(bytes.try_into().unwrap()))
+        .collect();
+
+    Ok((codomain_function, input_parameters, codomain))
+}
+
 ///Get the codomain values from a file's content iterator
 /// First skip a given number of lines and then read all the values
 pub fn get_codomain_from_iterator(
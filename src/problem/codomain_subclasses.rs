@@ -4,7 +4,7 @@ Module with all implemented codomain subclasses that can be generated with the c
 
 use structopt::StructOpt;
 
-use super::clique_tree::{get_possible_substrings, InputParameters};
+use super::clique_tree::InputParameters;
 
 use std::fmt;
 
@@ -31,6 +31,12 @@ pub enum CodomainFunction {
     RandomDeceptiveTrap {
         p_deceptive: f64,
     },
+    ///Virtual random codomain: every value is computed on demand from a counter-mode PRF of the
+    /// stored seed and the (clique index, substring index) pair, so no codomain table is materialized
+    #[structopt(name = "virtual-random")]
+    VirtualRandom {
+        seed: u64,
+    },
     Unknown,
 }
 
@@ -46,6 +52,7 @@ impl CodomainFunction {
             CodomainFunction::RandomDeceptiveTrap { p_deceptive } => {
                 format!("random-deceptive-trap-{}", p_deceptive)
             }
+            CodomainFunction::VirtualRandom { seed } => format!("virtual-random-{}", seed),
             CodomainFunction::Unknown => "unknown".to_owned(),
         }
     }
@@ -63,6 +70,7 @@ impl fmt::Display for CodomainFunction {
             } => {
                 write!(f, "random-deceptive-trap {}", p_random)
             }
+            CodomainFunction::VirtualRandom { seed } => write!(f, "virtual-random {}", seed),
             CodomainFunction::Unknown => write!(f, "unknown"),
         }
     }
@@ -70,8 +78,6 @@ impl fmt::Display for CodomainFunction {
 
 ///Generate random codomain values
 pub fn generate_random(input_parameters: &InputParameters, rng: &mut ChaChaRng) -> Vec<Vec<f64>> {
-    let die = Uniform::from(0.0..1.0);
-
     let m = input_parameters.m;
     let k = input_parameters.k;
 
@@ -82,15 +88,22 @@ pub fn generate_random(input_parameters: &InputParameters, rng: &mut ChaChaRng)
 
     for _ in 0..m {
         let mut codomain_clique = Vec::with_capacity((1 << k) as usize);
-        for _ in 0..(1 << k) {
-            codomain_clique.push(die.sample(rng));
-        }
+        fill_random_clique_row(k, rng, &mut codomain_clique);
         codomain_tree.push(codomain_clique);
     }
 
     codomain_tree
 }
 
+///Fill one clique's codomain row with random values; streaming building block of generate_random
+pub fn fill_random_clique_row(k: u32, rng: &mut ChaChaRng, row: &mut Vec<f64>) {
+    let die = Uniform::from(0.0..1.0);
+    row.clear();
+    for _ in 0..(1 << k) {
+        row.push(die.sample(rng));
+    }
+}
+
 ///Generate general deceptive trap values:
 /// For each subfunction, the local deceptor / local deceptive attractor is a random bit string of length k
 ///  and the local optimum is the inverse of that random bit string.
@@ -104,90 +117,77 @@ pub fn generate_trap_general(input_parameters: &InputParameters, rng: &mut ChaCh
     //Ensure k is smaller than 32, as otherwise the bit shift goes out of bounds on 32-bit machines
     assert!(k < 32);
 
-    let possible_clique_substrings = get_possible_substrings(k);
-
     let mut codomain = Vec::with_capacity(m as usize);
     for _i in 0..m {
-        let local_deceptor = get_random_solution(k, rng);
-
         let mut codomain_clique = Vec::with_capacity(1 << k);
-        for j in 0..(1 << k) {
-            // d
-            let distance_to_deceptor =
-                get_hamming_distance_to_solution(&local_deceptor, &possible_clique_substrings[j]);
-            let value = if distance_to_deceptor == k {
-                //if local optimum
-                1.0
-            } else {
-                //otherwise it's the local deceptive attractor or any other bit string
-                0.9 - distance_to_deceptor as f64 * (0.9 / k as f64)
-            };
-            codomain_clique.push(value);
-        }
+        fill_trap_general_clique_row(k, rng, &mut codomain_clique);
         codomain.push(codomain_clique);
     }
 
     codomain
 }
 
+///Fill one clique's codomain row with general deceptive trap values; streaming building block of generate_trap_general
+pub fn fill_trap_general_clique_row(k: u32, rng: &mut ChaChaRng, row: &mut Vec<f64>) {
+    let local_deceptor = get_random_solution(k, rng);
+    fill_trap_row_for_deceptor(k, &local_deceptor, row);
+}
+
+///Fill one clique's codomain row with the deceptive trap values for the given local deceptor
+fn fill_trap_row_for_deceptor(k: u32, local_deceptor: &[u32], row: &mut Vec<f64>) {
+    //Represent the local deceptor as a substring index, so that the hamming distance to any
+    // other substring index is a xor plus popcount instead of a per-bit comparison
+    let deceptor_index = local_deceptor
+        .iter()
+        .fold(0u32, |index, &bit| (index << 1) | bit);
+
+    row.clear();
+    for j in 0..(1u32 << k) {
+        // d
+        let distance_to_deceptor = (j ^ deceptor_index).count_ones();
+        let value = if distance_to_deceptor == k {
+            //if local optimum
+            1.0
+        } else {
+            //otherwise it's the local deceptive attractor or any other bit string
+            0.9 - distance_to_deceptor as f64 * (0.9 / k as f64)
+        };
+        row.push(value);
+    }
+}
+
 ///Generate the codomain for the combination of random and deceptive trap codomain functions:
 /// With probability p_deceptive, each clique/subfunction is a deceptive trap function,
 ///  and with probability (1 - p_deceptive) each clique/subfunction is a random function.
 pub fn generate_random_trap(input_parameters: &InputParameters, p_deceptive: f64, rng: &mut ChaChaRng) -> Vec<Vec<f64>> {
-    let die = Uniform::from(0.0..1.0);
-
     let m = input_parameters.m;
     let k = input_parameters.k;
 
     //Ensure k is smaller than 32, as otherwise the bit shift goes out of bounds on 32-bit machines
     assert!(k < 32);
 
-    let possible_clique_substrings = get_possible_substrings(k);
     let mut codomain_tree = Vec::with_capacity(m as usize);
 
     for _ in 0..m {
         let mut codomain_clique = Vec::with_capacity(1 << k);
-
-        if die.sample(rng) > p_deceptive {
-            //Random
-            for _ in 0..(1 << k) {
-                codomain_clique.push(die.sample(rng));
-            }
-        } else {
-            //Deceptive trap
-            let local_deceptor = get_random_solution(k, rng);
-
-            for j in 0..(1 << k) {
-                let distance_to_deceptor = get_hamming_distance_to_solution(
-                    &local_deceptor,
-                    &possible_clique_substrings[j],
-                );
-                let value = if distance_to_deceptor == k {
-                    1.0
-                } else {
-                    0.9 - distance_to_deceptor as f64 * (0.9 / k as f64)
-                };
-                codomain_clique.push(value);
-            }
-        }
-
+        fill_random_trap_clique_row(k, p_deceptive, rng, &mut codomain_clique);
         codomain_tree.push(codomain_clique);
     }
 
     codomain_tree
 }
 
-///Get the hamming distance to a solution, by counting the number of unequal bits in the bit strings
-fn get_hamming_distance_to_solution(target_solution: &[u32], solution: &[u32]) -> u32 {
-    assert_eq!(target_solution.len(), solution.len());
+///Fill one clique's codomain row with either random or deceptive trap values; streaming building block of generate_random_trap
+pub fn fill_random_trap_clique_row(k: u32, p_deceptive: f64, rng: &mut ChaChaRng, row: &mut Vec<f64>) {
+    let die = Uniform::from(0.0..1.0);
 
-    let mut distance = 0;
-    for i in 0..solution.len() {
-        if target_solution[i] != solution[i] {
-            distance += 1;
-        }
+    if die.sample(rng) > p_deceptive {
+        //Random
+        fill_random_clique_row(k, rng, row);
+    } else {
+        //Deceptive trap
+        fill_trap_general_clique_row(k, rng, row);
     }
-    distance
 }
 
 ///Constrcut a trap codomain, with the definition as in <http://www.cs.uu.nl/docs/vakken/ea/pdf/Prac1.pdf>
@@ -198,19 +198,25 @@ pub fn generate_trap(input_parameters: &InputParameters, d: f64) -> Vec<Vec<f64>
     //Ensure k is smaller than 32, as otherwise the bit shift goes out of bounds
     assert!(k < 32);
 
+    let mut codomain_clique = Vec::with_capacity(1 << k);
+    fill_trap_clique_row(k, d, &mut codomain_clique);
+
+    (0..m).map(|_| codomain_clique.clone()).collect()
+}
+
+///Fill one clique's codomain row with trap values; streaming building block of generate_trap.
+///Every clique gets the same row, so streaming callers compute it once and replay it.
+pub fn fill_trap_clique_row(k: u32, d: f64, row: &mut Vec<f64>) {
     let multiplication_factor = ((k as f64) - d) / ((k - 1) as f64);
 
-    let mut codomain_clique = Vec::with_capacity(1 << k);
+    row.clear();
     for i in 0..(1 << k) {
         if count_ones(k, i) == k {
-            codomain_clique.push(k as f64);
+            row.push(k as f64);
         } else {
-            codomain_clique
-                .push(((k as f64) - d - multiplication_factor * (count_ones(k, i) as f64)) as f64);
+            row.push(((k as f64) - d - multiplication_factor * (count_ones(k, i) as f64)) as f64);
         }
     }
-
-    (0..m).map(|_| codomain_clique.clone()).collect()
 }
 
 ///Generate NKq codomain values
@@ -219,53 +225,129 @@ pub fn generate_nk_q(input_parameters: &InputParameters, q: u32, rng: &mut ChaCh
     let m = input_parameters.m;
     let k = input_parameters.k;
 
-    let die = Uniform::from(0..q);
-
     let mut codomain = Vec::with_capacity(m as usize);
     for _ in 0..m {
-        let codomain_clique: Vec<f64> = (0..(1 << k))
-            .map(|_| die.sample(rng) as f64 / (q - 1) as f64)
-            .collect();
+        let mut codomain_clique = Vec::with_capacity(1 << k);
+        fill_nk_q_clique_row(k, q, rng, &mut codomain_clique);
         codomain.push(codomain_clique);
     }
     codomain
 }
 
+///Fill one clique's codomain row with NKq values; streaming building block of generate_nk_q
+pub fn fill_nk_q_clique_row(k: u32, q: u32, rng: &mut ChaChaRng, row: &mut Vec<f64>) {
+    let die = Uniform::from(0..q);
+    row.clear();
+    for _ in 0..(1 << k) {
+        row.push(die.sample(rng) as f64 / (q - 1) as f64);
+    }
+}
+
 ///Generate NKp codomain values
 ///The p value indicated the percentage of codomain values to be 0, per clique
 pub fn generate_nk_p(input_parameters: &InputParameters, p: f64, rng: &mut ChaChaRng) -> Vec<Vec<f64>> {
     let m = input_parameters.m;
     let k = input_parameters.k;
 
-    let num_zeroes = (p * (1 << k) as f64).round() as u32;
-
-    let die = Uniform::from(0.0..1.0);
-
     let mut codomain_clique_indices: Vec<u32> = (0..(1 << k)).collect();
+    let mut no_contribution_mask = Vec::with_capacity(1 << k);
     let mut codomain = Vec::with_capacity(m as usize);
 
     for _ in 0..m {
-        let mut codomain_clique = Vec::with_capacity(k as usize);
-        codomain_clique_indices.shuffle(rng);
-
-        let no_contribution_indices: Vec<&u32> = codomain_clique_indices
-            .iter()
-            .take(num_zeroes as usize)
-            .collect();
-
-        for i in 0..(1 << k) {
-            if no_contribution_indices.contains(&&i) {
-                codomain_clique.push(0.0);
-            } else {
-                codomain_clique.push(die.sample(rng));
-            }
-        }
+        let mut codomain_clique = Vec::with_capacity(1 << k);
+        fill_nk_p_clique_row(
+            k,
+            p,
+            rng,
+            &mut codomain_clique_indices,
+            &mut no_contribution_mask,
+            &mut codomain_clique,
+        );
         codomain.push(codomain_clique);
     }
 
     codomain
 }
 
+///Fill one clique's codomain row with NKp values; streaming building block of generate_nk_p.
+///The indices scratch vector must be initialized to 0..2^k by the caller and is reshuffled across rows,
+/// matching the state the batch generator carries between cliques.
+pub fn fill_nk_p_clique_row(
+    k: u32,
+    p: f64,
+    rng: &mut ChaChaRng,
+    codomain_clique_indices: &mut Vec<u32>,
+    no_contribution_mask: &mut Vec<bool>,
+    row: &mut Vec<f64>,
+) {
+    let num_zeroes = (p * (1 << k) as f64).round() as u32;
+
+    let die = Uniform::from(0.0..1.0);
+
+    codomain_clique_indices.shuffle(rng);
+
+    //Mark the zero positions in the reusable mask, so that the per-index membership test below is
+    // one lookup instead of a scan over all zero positions, which made a row cost O(4^k) in total.
+    //The shuffle and the in-index-order sampling are unchanged, so the generated values stay
+    // identical to the previous implementation for the same seed.
+    no_contribution_mask.clear();
+    no_contribution_mask.resize(1 << k, false);
+    for &index in codomain_clique_indices.iter().take(num_zeroes as usize) {
+        no_contribution_mask[index as usize] = true;
+    }
+
+    row.clear();
+    for i in 0..(1 << k) as usize {
+        if no_contribution_mask[i] {
+            row.push(0.0);
+        } else {
+            row.push(die.sample(rng));
+        }
+    }
+}
+
+///Generate the virtual random codomain as a materialized table, for the code paths that still
+/// want all values up front (e.g. writing a codomain file for inspection)
+pub fn generate_virtual_random(input_parameters: &InputParameters, seed: u64) -> Vec<Vec<f64>> {
+    let m = input_parameters.m;
+    let k = input_parameters.k;
+
+    //Ensure k is smaller than 32, as otherwise the bit shift goes out of bounds on 32-bit machines
+    assert!(k < 32);
+
+    let mut codomain_tree = Vec::with_capacity(m as usize);
+
+    for clique_index in 0..m {
+        let mut codomain_clique = Vec::with_capacity((1 << k) as usize);
+        fill_virtual_random_clique_row(k, seed, clique_index, &mut codomain_clique);
+        codomain_tree.push(codomain_clique);
+    }
+
+    codomain_tree
+}
+
+///Compute one virtual random codomain value from the seed and the (clique index, substring index) pair.
+///The seed keys the ChaCha block function, the clique index selects the stream and the substring index
+/// the word position within it, so every (clique, substring) pair maps to its own deterministic uniform
+/// draw from [0, 1) without any stored table — a lookup costs one ChaCha block instead of a memory read.
+pub fn virtual_codomain_value(seed: u64, clique_index: u32, substring_index: u32) -> f64 {
+    let mut rng = ChaChaRng::seed_from_u64(seed);
+    rng.set_stream(clique_index as u64);
+    //A uniform f64 draw consumes two 32-bit words
+    rng.set_word_pos(substring_index as u128 * 2);
+    let die = Uniform::from(0.0..1.0);
+    die.sample(&mut rng)
+}
+
+///Fill one clique's codomain row with virtual random values; materializing counterpart of
+/// virtual_codomain_value, used when a full row is needed (e.g. by the optimum calculation)
+pub fn fill_virtual_random_clique_row(k: u32, seed: u64, clique_index: u32, row: &mut Vec<f64>) {
+    row.clear();
+    for substring_index in 0..(1u32 << k) {
+        row.push(virtual_codomain_value(seed, clique_index, substring_index));
+    }
+}
+
 ///Count the number of ones in the bit string represented by and as the index
 fn count_ones(k: u32, index: u32) -> u32 {
     //Bit shift every element to the first index and then AND it with 1 to be able to add the number 1 to the sum,
@@ -2,9 +2,11 @@
 Module for reading the configuration ranges (and iterating over it)
 */
 
-use structopt::StructOpt;
-use rand_chacha::ChaChaRng;
 use rand::SeedableRng;
+use rand_chacha::ChaChaRng;
+use rayon::iter::IndexedParallelIterator;
+use rayon::prelude::*;
+use structopt::StructOpt;
 
 use std::{error::Error, path::Path};
 
@@ -109,6 +111,46 @@ impl ConfigurationParameters {
             codomain_function,
         ))
     }
+
+    ///The number of values a (begin, end) dimension takes: end is exclusive, and a dimension whose
+    /// range is empty or collapsed still contributes its begin value, matching the iterator
+    fn dimension_length(begin: u32, end: u32) -> usize {
+        (end.saturating_sub(begin)).max(1) as usize
+    }
+
+    ///The number of parameter configurations in the space, computed from the ranges
+    pub fn len(&self) -> usize {
+        Self::dimension_length(self.m_begin, self.m_end)
+            * Self::dimension_length(self.k_begin, self.k_end)
+            * Self::dimension_length(self.o_begin, self.o_end)
+            * Self::dimension_length(self.b_begin, self.b_end)
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    ///Get the configuration at the given index of the deterministic iteration order
+    /// (b varies fastest, then o, then k, then m), by direct odometer arithmetic.
+    ///Indexing agrees exactly with the sequential iterator, so a sweep can be chunked by index
+    /// range across threads or cluster jobs without materializing the cross product.
+    pub fn get(&self, index: usize) -> InputParameters {
+        let b_length = Self::dimension_length(self.b_begin, self.b_end);
+        let o_length = Self::dimension_length(self.o_begin, self.o_end);
+        let k_length = Self::dimension_length(self.k_begin, self.k_end);
+        InputParameters::new_from_primitives(
+            self.m_begin + (index / (b_length * o_length * k_length)) as u32,
+            self.k_begin + ((index / (b_length * o_length)) % k_length) as u32,
+            self.o_begin + ((index / b_length) % o_length) as u32,
+            self.b_begin + (index % b_length) as u32,
+        )
+    }
+
+    ///A rayon indexed parallel iterator over the configuration space, in the same deterministic
+    /// order as the sequential iterator; len and position are known, so rayon can split and chunk it
+    pub fn par_iter(&self) -> impl IndexedParallelIterator<Item = InputParameters> + '_ {
+        (0..self.len()).into_par_iter().map(move |index| self.get(index))
+    }
 }
 
 ///Get iterator from configuration parameters struct, for convenient iteration
@@ -2,8 +2,11 @@
 Module for functions related to reading and writing to files, mainly for reading stored clique trees
 */
 
+use indicatif::ParallelProgressIterator;
 use itertools::Itertools;
+use rand::SeedableRng;
 use rand_chacha::ChaChaRng;
+use rayon::prelude::*;
 use structopt::StructOpt;
 // use itertools::Itertools;
 use itertools::izip;
@@ -75,6 +78,42 @@ pub fn get_clique_trees_paths_from_codomain_folder(
         .collect())
 }
 
+///Get the clique tree and path for each file in the passed codomain folder path,
+/// with the files spread over a rayon thread pool.
+///Every file derives its own RNG from the master seed, by using the file's position in the sorted
+/// file order as the ChaCha stream number, so the constructed trees are identical for a given
+/// master seed, regardless of the number of threads.
+pub fn get_clique_trees_paths_from_codomain_folder_parallel(
+    folder_path: &Path,
+    files_have_codomain_function: bool,
+    master_seed: u64,
+) -> Result<Vec<(CliqueTree, PathBuf)>, Box<dyn Error>> {
+    let file_paths: Vec<PathBuf> = folder_path
+        .read_dir()?
+        .map(|file| file.unwrap().path())
+        .sorted()
+        .collect();
+
+    let number_of_files = file_paths.len() as u64;
+    file_paths
+        .into_par_iter()
+        .enumerate()
+        .progress_count(number_of_files)
+        .map(|(file_index, path)| {
+            //Derive this file's RNG from the master seed by selecting its own ChaCha stream
+            let mut rng = ChaChaRng::seed_from_u64(master_seed);
+            rng.set_stream(file_index as u64);
+
+            //Errors are reported back as strings, as io errors are not Sync
+            let clique_tree =
+                get_clique_tree_from_codomain_file(&path, files_have_codomain_function, &mut rng)
+                    .map_err(|error| error.to_string())?;
+            Ok((clique_tree, path))
+        })
+        .collect::<Result<Vec<(CliqueTree, PathBuf)>, String>>()
+        .map_err(|error| error.into())
+}
+
 ///Get from a folder the triples configuration_parameters - problem_folder - codomain_folder
 /// from the problem_generation, problems, and codomain_files folders.
 /// Each file in problem_generation is coupled with the corresponding folder in 'problems' and 'codomain_files'
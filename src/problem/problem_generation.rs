@@ -2,26 +2,33 @@
 Module to generate problems (TD Mk Landscapes) using passed codomain, read these problems and write them (using (de)serialization ).
 */
 
+use indicatif::ParallelProgressIterator;
 use itertools::Itertools;
+use rand::SeedableRng;
 use rand_chacha::ChaChaRng;
+use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
 use structopt::StructOpt;
 
 use std::{
+    convert::TryInto,
     error::Error,
     fmt::Write as fmt_write,
-    fs::File,
-    io::{BufRead, BufReader, BufWriter, Write},
+    fs::{self, File},
+    io::{BufReader, BufWriter, Write},
     path::{Path, PathBuf},
 };
 
 
 use super::{
-    clique_tree::{CliqueTree, InputParameters},
-    codomain::{read_codomain, generate_write_return},
-    io::{get_clique_tree_from_codomain_file, get_clique_trees_paths_from_codomain_folder, 
+    archive::ArchiveWriter,
+    clique_tree::{CliqueTree, InputParameters, OptimaCalculationScratch},
+    codomain::{read_binary_f64, read_binary_u32, read_binary_u64, read_codomain},
+    codomain_subclasses::CodomainFunction,
+    io::{get_clique_tree_from_codomain_file, get_clique_trees_paths_from_codomain_folder,
             get_output_folder_path_from_configuration_file},
-    configuration::{get_rng}
+    configuration::{get_rng},
+    stats::{GenerationStage, GenerationStats}
 };
 
 use super::configuration::ConfigurationParameters;
@@ -50,6 +57,11 @@ pub enum ProblemCommand {
         ///Whether the codomain was generated by the problem generator / whether the codomain contains the codomain function on the first line
         #[structopt(short = "g")]
         generated: bool,
+        ///Generate the problems in parallel over all available cores.
+        /// Every codomain file derives its own RNG stream from the seed and its sorted position,
+        /// so the output is reproducible for a given seed.
+        #[structopt(short = "p", long = "parallel")]
+        parallel: bool,
     },
     /// Generate problems for configurations specified in a given directory that contains a directory 'problem_generation'
     ///  with files specifying the codomain parameters and ranges of topology parameters
@@ -61,6 +73,9 @@ pub enum ProblemCommand {
         ///number of problems to generate per configuration instance
         #[structopt(default_value = "1", short = "n")]
         number_of_problems_to_generate: u32,
+        ///Report per-stage wall time, bytes written and optima counts at the end of the run
+        #[structopt(long = "stats")]
+        stats: bool,
     },
     /// Generate problems for a configuration specified in a given file that already contains the codomain
     #[structopt(name = "codomain_file")]
@@ -90,6 +105,56 @@ pub enum ProblemCommand {
         ///number of problems to generate per configuration instance
         #[structopt(default_value = "1", short = "n")]
         number_of_problems_to_generate: u32,
+        ///Generate the instances in parallel over all available cores.
+        /// Every instance derives its own RNG stream from the seed, so the output is bit-identical
+        /// for a given seed regardless of the number of threads (but differs from a sequential run,
+        /// which draws all instances from one continuous stream).
+        #[structopt(short = "p", long = "parallel")]
+        parallel: bool,
+        ///Report per-stage wall time, bytes written and optima counts at the end of the run
+        #[structopt(long = "stats")]
+        stats: bool,
+    },
+    /// Generate instances for ranges of configurations across an internal worker pool, with
+    ///  per-instance RNG streams derived from the master seed and a manifest recording the
+    ///  seed-to-file mapping, so any single instance can be regenerated alone
+    #[structopt(name = "sweep")]
+    Sweep {
+        ///Input configuration_parameters file to read and to generate codomain files and problems for
+        #[structopt(parse(from_os_str))]
+        input_configuration_file_path: PathBuf,
+        ///Folder to write the generated codomains to
+        #[structopt(parse(from_os_str))]
+        output_codomain_folder_path: PathBuf,
+        ///Folder to write the generated problem(s) to
+        #[structopt(parse(from_os_str))]
+        output_problem_folder_path: PathBuf,
+        ///number of problems to generate per configuration instance
+        #[structopt(default_value = "1", short = "n")]
+        number_of_problems_to_generate: u32,
+        ///Number of worker threads; defaults to all available cores
+        #[structopt(short = "j", long = "jobs")]
+        jobs: Option<usize>,
+        ///File to write the manifest to; defaults to sweep_manifest.txt in the problem folder
+        #[structopt(long = "manifest", parse(from_os_str))]
+        manifest_file_path: Option<PathBuf>,
+        ///Report per-stage wall time, bytes written and optima counts at the end of the run
+        #[structopt(long = "stats")]
+        stats: bool,
+    },
+    /// Generate a single archive file holding the codomain and problem records of all instances
+    ///  for ranges of configurations specified in a given file
+    #[structopt(name = "configuration_file_archive")]
+    ConfigurationFileArchive {
+        ///Input configuration_parameters file to read and to generate codomain and problem records for
+        #[structopt(parse(from_os_str))]
+        input_configuration_file_path: PathBuf,
+        ///Archive file to write the generated codomain and problem records to
+        #[structopt(parse(from_os_str))]
+        output_archive_file_path: PathBuf,
+        ///number of problems to generate per configuration instance
+        #[structopt(default_value = "1", short = "n")]
+        number_of_problems_to_generate: u32,
     },
 }
 
@@ -100,23 +165,40 @@ pub fn run_opt(problem_opt: ProblemOpt) -> Result<(), Box<dyn Error>> {
         ProblemCommand::CodomainFolder {
             folder_paths,
             generated,
+            parallel,
         } => {
-            for folder_path in folder_paths {
-                generate_problems_from_codomain_folder(&folder_path, generated, &mut rng)?;
+            if parallel {
+                //When no seed is passed, we draw a random master seed, so that the file streams are still derived consistently.
+                let master_seed = problem_opt.seed.unwrap_or_else(rand::random);
+                for folder_path in folder_paths {
+                    generate_problems_from_codomain_folder_parallel(
+                        &folder_path,
+                        generated,
+                        master_seed,
+                    )?;
+                }
+            } else {
+                for folder_path in folder_paths {
+                    generate_problems_from_codomain_folder(&folder_path, generated, &mut rng)?;
+                }
             }
             Ok(())
         }
         ProblemCommand::ConfigurationFolder {
             folder_paths,
             number_of_problems_to_generate,
+            stats,
         } => {
+            let mut generation_stats = GenerationStats::new(stats);
             for folder_path in folder_paths {
                 generate_codomain_and_problem_from_folder(
                     &folder_path,
                     number_of_problems_to_generate,
                     &mut rng,
+                    &mut generation_stats,
                 )?;
             }
+            generation_stats.report();
             Ok(())
         }
         ProblemCommand::CodomainFile {
@@ -136,15 +218,70 @@ pub fn run_opt(problem_opt: ProblemOpt) -> Result<(), Box<dyn Error>> {
             output_codomain_folder_path,
             output_problem_folder_path,
             number_of_problems_to_generate,
+            parallel,
+            stats,
         } => {
-            generate_codomain_and_problem(
+            let mut generation_stats = GenerationStats::new(stats);
+            if parallel {
+                //When no seed is passed, we draw a random master seed, so that the instance streams are still derived consistently.
+                let master_seed = problem_opt.seed.unwrap_or_else(rand::random);
+                generate_codomain_and_problem_parallel(
+                    &input_configuration_file_path,
+                    Some(&output_codomain_folder_path),
+                    Some(&output_problem_folder_path),
+                    number_of_problems_to_generate,
+                    master_seed,
+                    &mut generation_stats,
+                )?;
+            } else {
+                generate_codomain_and_problem(
+                    &input_configuration_file_path,
+                    Some(&output_codomain_folder_path),
+                    Some(&output_problem_folder_path),
+                    number_of_problems_to_generate,
+                    &mut rng,
+                    &mut generation_stats,
+                )?;
+            }
+            generation_stats.report();
+            Ok(())
+        }
+        ProblemCommand::Sweep {
+            input_configuration_file_path,
+            output_codomain_folder_path,
+            output_problem_folder_path,
+            number_of_problems_to_generate,
+            jobs,
+            manifest_file_path,
+            stats,
+        } => {
+            //When no seed is passed, we draw a random master seed, so that the instance streams
+            // are still derived consistently and the manifest stays usable for regeneration.
+            let master_seed = problem_opt.seed.unwrap_or_else(rand::random);
+            let mut generation_stats = GenerationStats::new(stats);
+            sweep_codomain_and_problem(
                 &input_configuration_file_path,
-                Some(&output_codomain_folder_path),
-                Some(&output_problem_folder_path),
+                &output_codomain_folder_path,
+                &output_problem_folder_path,
                 number_of_problems_to_generate,
-                &mut rng
-            )
+                master_seed,
+                jobs,
+                manifest_file_path.as_deref(),
+                &mut generation_stats,
+            )?;
+            generation_stats.report();
+            Ok(())
         }
+        ProblemCommand::ConfigurationFileArchive {
+            input_configuration_file_path,
+            output_archive_file_path,
+            number_of_problems_to_generate,
+        } => generate_codomain_and_problem_archive(
+            &input_configuration_file_path,
+            &output_archive_file_path,
+            number_of_problems_to_generate,
+            &mut rng,
+        ),
     }
 }
 
@@ -162,9 +299,19 @@ impl Problem {
     fn new(clique_tree: &CliqueTree) -> Problem {
         Problem {
             input_parameters: clique_tree.input_parameters.clone(),
-            cliques: clique_tree.cliques.clone(),
+            //The clique tree stores its cliques flat with stride k; chunk them back into one vector per clique
+            cliques: clique_tree
+                .cliques
+                .chunks(clique_tree.input_parameters.k as usize)
+                .map(|clique| clique.to_vec())
+                .collect(),
             glob_optima_score: clique_tree.glob_optima_score,
-            glob_optima_strings: clique_tree.glob_optima_strings.clone(),
+            //The Problem struct stores the optima materialized, so enumerate them from the
+            // product form when the clique tree did not materialize them itself
+            glob_optima_strings: match &clique_tree.global_optima {
+                Some(global_optima) => global_optima.enumerate(&clique_tree.cliques),
+                None => clique_tree.glob_optima_strings.clone(),
+            },
         }
     }
 }
@@ -215,11 +362,83 @@ pub fn generate_problems_from_codomain_folder(
     Ok(())
 }
 
+///Generate problems from the codomain and input parameters,
+/// which are both given by the files in the parent's codomain folder and write them to the parent's problems folder,
+/// with the codomain files of each folder spread over a rayon thread pool.
+///Every file derives its own RNG from the master seed, by using the file's position in the sorted file order
+/// of its folder as the ChaCha stream number, so the generated problems are identical for a given
+/// master seed, regardless of the number of threads.
+pub fn generate_problems_from_codomain_folder_parallel(
+    parent_folder_path: &Path,
+    generated: bool,
+    master_seed: u64,
+) -> Result<(), Box<dyn Error>> {
+    let mut codomain_folder_path = PathBuf::from(parent_folder_path);
+    codomain_folder_path.push("codomain_files");
+    let mut problems_folder_path = PathBuf::from(parent_folder_path);
+    problems_folder_path.push("problems");
+
+    //get all folder entries in the codomain_files folder
+    let folder_entries: Vec<PathBuf> = codomain_folder_path
+        .read_dir()?
+        .map(|folder| folder.unwrap().path())
+        .sorted()
+        .collect();
+
+    //For each folder f,
+    for folder in folder_entries {
+        // Create a directory in the problems folder with the same name (f)
+        let mut output_folder_path = problems_folder_path.clone();
+        output_folder_path.push(
+            folder
+                .file_name()
+                .ok_or("could not get file name of folder")?,
+        );
+        std::fs::create_dir_all(&output_folder_path)?;
+
+        //Fan the codomain files out over the rayon pool; each file is read, turned into a clique tree
+        // (including the optimum calculation) and written out as a problem on the worker itself,
+        // so no thread ever holds more than one clique tree.
+        let file_paths: Vec<PathBuf> = folder
+            .read_dir()?
+            .map(|file| file.unwrap().path())
+            .sorted()
+            .collect();
+
+        let number_of_files = file_paths.len() as u64;
+        file_paths
+            .into_par_iter()
+            .enumerate()
+            .progress_count(number_of_files)
+            .try_for_each(|(file_index, path)| {
+                //Derive this file's RNG from the master seed by selecting its own ChaCha stream
+                let mut rng = ChaChaRng::seed_from_u64(master_seed);
+                rng.set_stream(file_index as u64);
+
+                //Errors are reported back as strings, as io errors are not Sync
+                let clique_tree = get_clique_tree_from_codomain_file(&path, generated, &mut rng)
+                    .map_err(|error| error.to_string())?;
+
+                let mut output_path = output_folder_path.clone();
+                output_path.push(
+                    path.file_name()
+                        .ok_or("could not get filename of codomain file")?,
+                );
+                //write the output problem to disk
+                write_problem_to_file(&clique_tree, &output_path)
+                    .map_err(|error| error.to_string())
+            })
+            .map_err(|error| -> Box<dyn Error> { error.into() })?;
+    }
+    Ok(())
+}
+
 ///Generate a problem from the codomain and input parameters given by codomain_file_path and write it to output_path
 pub fn generate_codomain_and_problem_from_folder(
     input_folder_path: &Path,
     number_of_problems_to_generate: u32,
-    rng: &mut ChaChaRng
+    rng: &mut ChaChaRng,
+    stats: &mut GenerationStats,
 ) -> Result<(), Box<dyn Error>> {
     //Use the input_folder_path to get the problem_generation folder and problems folder paths
     let mut problem_generation_path = PathBuf::from(input_folder_path);
@@ -234,7 +453,7 @@ pub fn generate_codomain_and_problem_from_folder(
 
     // generate all codomain and problem files and write them to the codomain_files and problems folders
     for file in file_entries {
-        generate_codomain_and_problem(&file, None, None, number_of_problems_to_generate, rng)?;
+        generate_codomain_and_problem(&file, None, None, number_of_problems_to_generate, rng, stats)?;
     }
     Ok(())
 }
@@ -242,12 +461,31 @@ pub fn generate_codomain_and_problem_from_folder(
 ///Generate codomain and problem files for the input configuration as read from the input_configuration_file.
 /// If the output_(codomain/problem)_folder_path is None, we default to folder paths used in other parts of the program (codomain_files & problems).
 /// If they are Some(path), we use the path as the destination folder.
+///Reusable buffers for the instance-generation loops: the flat codomain matrix, the
+/// optimum-calculation scratch, and the file-formatting buffer.
+///One context threaded through a loop generating same-shape instances means the pipeline does no
+/// heap allocation after the first instance — every buffer is cleared and refilled, and the
+/// codomain allocation is handed to the clique tree and reclaimed after the instance is written.
+#[derive(Default)]
+pub struct GenerationContext {
+    optima_scratch: OptimaCalculationScratch,
+    codomain_values: Vec<f64>,
+    write_buffer: String,
+}
+
+impl GenerationContext {
+    pub fn new() -> GenerationContext {
+        GenerationContext::default()
+    }
+}
+
 pub fn generate_codomain_and_problem(
     input_configuration_file_path: &Path,
     output_codomain_folder_path: Option<&Path>,
     output_problem_folder_path: Option<&Path>,
     number_of_problems_to_generate: u32,
-    rng: &mut ChaChaRng
+    rng: &mut ChaChaRng,
+    stats: &mut GenerationStats,
 ) -> Result<(), Box<dyn Error>> {
     //Get the configuration parameters from the input configuration file
     let configuration_parameters =
@@ -273,15 +511,302 @@ pub fn generate_codomain_and_problem(
         )?,
     };
 
+    //One set of generation buffers for the whole loop, so the pipeline stops allocating
+    // after the first instance
+    let mut context = GenerationContext::new();
+
     //Loop over all input parameters (using custom iterator)
     for input_parameters in configuration_parameters {
         //Generate number_problems different problem instances for each input parameter configuration
         for num in 0..number_of_problems_to_generate {
-            let mut output_problem_file_path = output_problem_folder_path_buf.clone();
-            let mut output_codomain_file_path = output_codomain_folder_path_buf.clone();
+            generate_single_codomain_and_problem(
+                &input_parameters,
+                &codomain_function,
+                &output_codomain_folder_path_buf,
+                &output_problem_folder_path_buf,
+                num,
+                rng,
+                &mut context,
+                stats,
+            )?;
+        }
+    }
+    Ok(())
+}
+
+///Generate codomain and problem files for the input configuration as read from the input_configuration_file,
+/// with the (input_parameters, num) cross product spread over a rayon thread pool.
+///Every instance derives its own RNG from the master seed, by using the instance's position in the
+/// deterministic sequential order (input parameters outer, instance number inner) as the ChaCha stream number.
+/// The generated files are therefore bit-identical for a given master seed, regardless of the number of threads.
+pub fn generate_codomain_and_problem_parallel(
+    input_configuration_file_path: &Path,
+    output_codomain_folder_path: Option<&Path>,
+    output_problem_folder_path: Option<&Path>,
+    number_of_problems_to_generate: u32,
+    master_seed: u64,
+    stats: &mut GenerationStats,
+) -> Result<(), Box<dyn Error>> {
+    //Get the configuration parameters from the input configuration file
+    let configuration_parameters =
+        ConfigurationParameters::from_file(input_configuration_file_path)?;
+
+    let codomain_function = configuration_parameters.codomain_function.clone();
+
+    //if an output_problem_folder_path is passed, we use it, otherwise we default to our way of calculating where the file should go (into problems folder)
+    let output_problem_folder_path_buf = match output_problem_folder_path {
+        Some(folder) => PathBuf::from(folder),
+        None => get_output_folder_path_from_configuration_file(
+            input_configuration_file_path,
+            "problems",
+        )?,
+    };
+
+    //if a output_codomain_folder_path is passed, we use it, otherwise we default to our way of calculating where the file should go (into codomain_files)
+    let output_codomain_folder_path_buf = match output_codomain_folder_path {
+        Some(folder) => PathBuf::from(folder),
+        None => get_output_folder_path_from_configuration_file(
+            input_configuration_file_path,
+            "codomain_files",
+        )?,
+    };
+
+    //The (input_parameters, num) cross product in the same order as the sequential loop
+    // (input parameters outer, instance number inner) is addressed by index through the
+    // configuration space, so that the position of an instance is its deterministic stream number
+    // and the cross product is never materialized.
+    if number_of_problems_to_generate == 0 {
+        return Ok(());
+    }
+    let number_of_instances =
+        configuration_parameters.len() * number_of_problems_to_generate as usize;
+
+    //When the run is instrumented, every worker records into its own local stats and folds them
+    // into the shared aggregate once per instance, so the hot pipeline stays uncontended
+    let shared_stats = std::sync::Mutex::new(GenerationStats::new(stats.is_enabled()));
+
+    //Fan the instances out over the rayon pool; errors are reported back as strings, as io errors are not Sync.
+    (0..number_of_instances)
+        .into_par_iter()
+        .try_for_each(|instance_index| {
+            let input_parameters = configuration_parameters
+                .get(instance_index / number_of_problems_to_generate as usize);
+            let num = (instance_index % number_of_problems_to_generate as usize) as u32;
+
+            //Derive this instance's RNG from the master seed by selecting its own ChaCha stream
+            let mut rng = ChaChaRng::seed_from_u64(master_seed);
+            rng.set_stream(instance_index as u64);
+
+            let mut instance_stats = GenerationStats::new(stats.is_enabled());
+            generate_single_codomain_and_problem(
+                &input_parameters,
+                &codomain_function,
+                &output_codomain_folder_path_buf,
+                &output_problem_folder_path_buf,
+                num,
+                &mut rng,
+                &mut GenerationContext::new(),
+                &mut instance_stats,
+            )
+            .map_err(|error| error.to_string())?;
+            if instance_stats.is_enabled() {
+                shared_stats
+                    .lock()
+                    .map_err(|error| error.to_string())?
+                    .merge(&instance_stats);
+            }
+            Ok(())
+        })
+        .map_err(|error: String| -> Box<dyn Error> { error.into() })?;
+
+    stats.merge(&shared_stats.into_inner().map_err(|error| error.to_string())?);
+    Ok(())
+}
+
+///Generate codomain and problem files for the input configuration as read from the
+/// input_configuration_file, across an internal worker pool of `jobs` threads
+/// (all available cores when None).
+///The (input_parameters, num) cross product is materialized in the deterministic sequential order
+/// and fanned out over the pool with work stealing, so the uneven cost of large-m instances does
+/// not leave workers idle behind a static partition.
+///Every instance derives its own RNG from the master seed by using its position in that order as
+/// the ChaCha stream number, so the generated files are bit-identical for a given master seed
+/// regardless of the number of workers. A manifest records the master seed and the stream of every
+/// generated file, so any single instance can be regenerated alone by replaying only its stream.
+pub fn sweep_codomain_and_problem(
+    input_configuration_file_path: &Path,
+    output_codomain_folder_path: &Path,
+    output_problem_folder_path: &Path,
+    number_of_problems_to_generate: u32,
+    master_seed: u64,
+    jobs: Option<usize>,
+    manifest_file_path: Option<&Path>,
+    stats: &mut GenerationStats,
+) -> Result<(), Box<dyn Error>> {
+    //Get the configuration parameters from the input configuration file
+    let configuration_parameters =
+        ConfigurationParameters::from_file(input_configuration_file_path)?;
+
+    let codomain_function = configuration_parameters.codomain_function.clone();
+
+    fs::create_dir_all(output_codomain_folder_path)?;
+    fs::create_dir_all(output_problem_folder_path)?;
+
+    //The (input_parameters, num) cross product in the same order as the sequential loop is
+    // addressed by index through the configuration space, so that the position of an instance is
+    // its deterministic stream number and the cross product is never materialized.
+    if number_of_problems_to_generate == 0 {
+        return Ok(());
+    }
+    let number_of_instances =
+        configuration_parameters.len() * number_of_problems_to_generate as usize;
+
+    //A worker pool of the requested size; num_threads(0) lets rayon pick the number of cores
+    let worker_pool = rayon::ThreadPoolBuilder::new()
+        .num_threads(jobs.unwrap_or(0))
+        .build()?;
+
+    //When the run is instrumented, every worker records into its own local stats and folds them
+    // into the shared aggregate once per instance, so the hot pipeline stays uncontended
+    let shared_stats = std::sync::Mutex::new(GenerationStats::new(stats.is_enabled()));
+
+    worker_pool.install(|| {
+        //Fan the instances out over the pool; rayon's work stealing balances the uneven instance
+        // costs. Errors are reported back as strings, as io errors are not Sync.
+        (0..number_of_instances)
+            .into_par_iter()
+            .progress_count(number_of_instances as u64)
+            .try_for_each(|instance_index| {
+                let input_parameters = configuration_parameters
+                    .get(instance_index / number_of_problems_to_generate as usize);
+                let num = (instance_index % number_of_problems_to_generate as usize) as u32;
+
+                //Derive this instance's RNG from the master seed by selecting its own ChaCha stream
+                let mut rng = ChaChaRng::seed_from_u64(master_seed);
+                rng.set_stream(instance_index as u64);
+
+                let mut instance_stats = GenerationStats::new(stats.is_enabled());
+                generate_single_codomain_and_problem(
+                    &input_parameters,
+                    &codomain_function,
+                    output_codomain_folder_path,
+                    output_problem_folder_path,
+                    num,
+                    &mut rng,
+                    &mut GenerationContext::new(),
+                    &mut instance_stats,
+                )
+                .map_err(|error| error.to_string())?;
+                if instance_stats.is_enabled() {
+                    shared_stats
+                        .lock()
+                        .map_err(|error| error.to_string())?
+                        .merge(&instance_stats);
+                }
+                Ok(())
+            })
+    })
+    .map_err(|error: String| -> Box<dyn Error> { error.into() })?;
+    stats.merge(&shared_stats.into_inner().map_err(|error| error.to_string())?);
+
+    //Write the manifest in the deterministic instance order, after all instances are on disk
+    let manifest_path_buf = match manifest_file_path {
+        Some(path) => PathBuf::from(path),
+        None => {
+            let mut path = PathBuf::from(output_problem_folder_path);
+            path.push("sweep_manifest.txt");
+            path
+        }
+    };
+    write_sweep_manifest(
+        &manifest_path_buf,
+        &codomain_function,
+        master_seed,
+        &configuration_parameters,
+        number_of_problems_to_generate,
+    )
+}
+
+///Write the manifest of a sweep: the master seed and codomain function on the header lines,
+/// and then one line per instance with its ChaCha stream number, its input parameters and its
+/// file name. Regenerating one instance only needs its line:
+/// seed the RNG with the master seed, select the recorded stream, and generate the one instance.
+fn write_sweep_manifest(
+    manifest_file_path: &Path,
+    codomain_function: &CodomainFunction,
+    master_seed: u64,
+    configuration_parameters: &ConfigurationParameters,
+    number_of_problems_to_generate: u32,
+) -> Result<(), Box<dyn Error>> {
+    let file = File::create(manifest_file_path)?;
+    let mut buf_writer = BufWriter::new(file);
+    let mut write_buffer = String::with_capacity(super::codomain::WRITE_BUFFER_FLUSH_SIZE);
+
+    writeln!(write_buffer, "master_seed {}", master_seed)?;
+    writeln!(write_buffer, "codomain_function {}", codomain_function)?;
+    writeln!(write_buffer, "stream m k o b num file_name")?;
+
+    let number_of_instances =
+        configuration_parameters.len() * number_of_problems_to_generate as usize;
+    for instance_index in 0..number_of_instances {
+        let input_parameters = configuration_parameters
+            .get(instance_index / number_of_problems_to_generate as usize);
+        let num = (instance_index % number_of_problems_to_generate as usize) as u32;
+        writeln!(
+            write_buffer,
+            "{} {} {} {} {} {} {}_{}_{}_{}_{}_{}.txt",
+            instance_index,
+            input_parameters.m,
+            input_parameters.k,
+            input_parameters.o,
+            input_parameters.b,
+            num,
+            codomain_function.to_io_string(),
+            input_parameters.m,
+            input_parameters.k,
+            input_parameters.o,
+            input_parameters.b,
+            num
+        )?;
+        if write_buffer.len() >= super::codomain::WRITE_BUFFER_FLUSH_SIZE {
+            buf_writer.write_all(write_buffer.as_bytes())?;
+            write_buffer.clear();
+        }
+    }
+    buf_writer.write_all(write_buffer.as_bytes())?;
+    buf_writer.flush()?;
+
+    Ok(())
+}
+
+///Generate the codomain and problem records for the input configuration as read from the
+/// input_configuration_file, into a single archive file instead of one codomain and one problem file
+/// per instance, so that a parameter sweep costs one file create instead of tens of thousands.
+///The instances are generated in the same order and with the same RNG draws as
+/// generate_codomain_and_problem, and are named like the files that function would have created.
+pub fn generate_codomain_and_problem_archive(
+    input_configuration_file_path: &Path,
+    output_archive_file_path: &Path,
+    number_of_problems_to_generate: u32,
+    rng: &mut ChaChaRng,
+) -> Result<(), Box<dyn Error>> {
+    //Get the configuration parameters from the input configuration file
+    let configuration_parameters =
+        ConfigurationParameters::from_file(input_configuration_file_path)?;
+
+    let codomain_function = configuration_parameters.codomain_function.clone();
+
+    let mut archive_writer = ArchiveWriter::create(output_archive_file_path)?;
+
+    //One set of generation buffers for the whole loop
+    let mut context = GenerationContext::new();
 
-            let output_file_name = format!(
-                "{}_{}_{}_{}_{}_{}.txt",
+    //Loop over all input parameters (using custom iterator)
+    for input_parameters in configuration_parameters {
+        //Generate number_problems different problem instances for each input parameter configuration
+        for num in 0..number_of_problems_to_generate {
+            let instance_name = format!(
+                "{}_{}_{}_{}_{}_{}",
                 codomain_function.to_io_string(),
                 input_parameters.m,
                 input_parameters.k,
@@ -290,25 +815,121 @@ pub fn generate_codomain_and_problem(
                 num
             );
 
-            output_problem_file_path.push(output_file_name.clone());
-            output_codomain_file_path.push(output_file_name);
-            //println!("constructed output file path: {:?}", output_file_path);
-
-            let codomain =
-                generate_write_return(&input_parameters, &codomain_function, &output_codomain_file_path, rng)?;
-
-            //Generate a clique tree using the input parameter, the codomain function, and the codomain values
-            let clique_tree = CliqueTree::new(
+            //Generate the codomain and the clique tree, as in the per-file pipeline,
+            // with the codomain allocation reused across instances through the context
+            super::codomain::generate_codomain_flat_into(
+                &input_parameters,
+                &codomain_function,
+                rng,
+                &mut context.codomain_values,
+            )?;
+            let codomain_record = super::codomain::encode_codomain_binary(
+                &input_parameters,
+                &codomain_function,
+                &context.codomain_values,
+            );
+            let mut clique_tree = CliqueTree::new_with_flat_codomain_and_scratch(
                 input_parameters.clone(),
                 codomain_function.clone(),
-                codomain,
-                rng
+                std::mem::take(&mut context.codomain_values),
+                rng,
+                &mut context.optima_scratch,
             );
 
-            //Write the problem to disk
-            write_problem_to_file(&clique_tree, &output_problem_file_path)?;
+            //Encode the problem record and append both to the archive
+            let problem_record = encode_problem_binary(&Problem::new(&clique_tree));
+            archive_writer.append_instance(&instance_name, &codomain_record, &problem_record)?;
+            context.codomain_values = std::mem::take(&mut clique_tree.codomain_values);
         }
     }
+
+    archive_writer.finish()
+}
+
+///Generate the codomain and problem files for a single instance of the passed input parameters,
+/// writing them to the passed codomain and problem folders
+fn generate_single_codomain_and_problem(
+    input_parameters: &InputParameters,
+    codomain_function: &CodomainFunction,
+    output_codomain_folder_path: &Path,
+    output_problem_folder_path: &Path,
+    num: u32,
+    rng: &mut ChaChaRng,
+    context: &mut GenerationContext,
+    stats: &mut GenerationStats,
+) -> Result<(), Box<dyn Error>> {
+    let mut output_problem_file_path = PathBuf::from(output_problem_folder_path);
+    let mut output_codomain_file_path = PathBuf::from(output_codomain_folder_path);
+
+    let output_file_name = format!(
+        "{}_{}_{}_{}_{}_{}.txt",
+        codomain_function.to_io_string(),
+        input_parameters.m,
+        input_parameters.k,
+        input_parameters.o,
+        input_parameters.b,
+        num
+    );
+
+    output_problem_file_path.push(output_file_name.clone());
+    output_codomain_file_path.push(output_file_name);
+    //println!("constructed output file path: {:?}", output_file_path);
+
+    //Generate the codomain into the context's reusable flat buffer and write it to disk
+    let stage_start = stats.stage_start();
+    super::codomain::generate_codomain_flat_into(
+        input_parameters,
+        codomain_function,
+        rng,
+        &mut context.codomain_values,
+    )?;
+    stats.record_stage(GenerationStage::CodomainGeneration, stage_start);
+
+    let stage_start = stats.stage_start();
+    super::codomain::write_codomain_flat(
+        input_parameters,
+        codomain_function,
+        &output_codomain_file_path,
+        &context.codomain_values,
+        &mut context.write_buffer,
+    )?;
+    stats.record_stage(GenerationStage::CodomainWrite, stage_start);
+    if stats.is_enabled() {
+        stats.record_bytes_written(
+            GenerationStage::CodomainWrite,
+            fs::metadata(&output_codomain_file_path)?.len(),
+        );
+    }
+
+    //Generate a clique tree using the input parameter, the codomain function, and the codomain
+    // values; the codomain allocation is handed to the tree and reclaimed below
+    let mut clique_tree = CliqueTree::new_with_flat_codomain_scratch_and_stats(
+        input_parameters.clone(),
+        codomain_function.clone(),
+        std::mem::take(&mut context.codomain_values),
+        rng,
+        &mut context.optima_scratch,
+        stats,
+    );
+
+    //Write the problem to disk
+    let stage_start = stats.stage_start();
+    write_problem_to_file_with_buffer(
+        &clique_tree,
+        &output_problem_file_path,
+        &mut context.write_buffer,
+    )?;
+    stats.record_stage(GenerationStage::ProblemWrite, stage_start);
+    if stats.is_enabled() {
+        stats.record_bytes_written(
+            GenerationStage::ProblemWrite,
+            fs::metadata(&output_problem_file_path)?.len(),
+        );
+    }
+
+    //Take the codomain allocation back from the tree for the next instance
+    context.codomain_values = std::mem::take(&mut clique_tree.codomain_values);
+
     Ok(())
 }
 
@@ -339,6 +960,48 @@ pub fn read_clique_tree_from_files(
     ))
 }
 
+///Read the TD Mk Landscapes / clique trees from the codomain and problem folders,
+/// with the per-file loads spread over a rayon thread pool.
+/// We return the same Vector of tuples as read_clique_trees_paths_from_folders, in the same
+///  sorted file order, so the two functions are interchangeable.
+///Each worker reads its problem and codomain file in one whole-file read each and parses the
+/// problem from the byte slice, so startup of a many-instance experiment folder is bounded by
+/// disk bandwidth instead of per-line allocation on one core.
+pub fn read_clique_trees_paths_from_folders_parallel(
+    codomain_folder_path: &Path,
+    problem_folder_path: &Path,
+    generated: bool,
+) -> Result<Vec<(CliqueTree, PathBuf)>, Box<dyn Error>> {
+    //Get all codomain files
+    let codomain_file_entries: Vec<PathBuf> = codomain_folder_path
+        .read_dir()?
+        .map(|file| file.unwrap().path())
+        .sorted()
+        .collect();
+    //Get all problem files
+    let problem_file_entries: Vec<PathBuf> = problem_folder_path
+        .read_dir()?
+        .map(|file| file.unwrap().path())
+        .sorted()
+        .collect();
+
+    assert_eq!(codomain_file_entries.len(), problem_file_entries.len());
+
+    //zip the (sorted) codomains and problems and fan the pairs out over the rayon pool;
+    // errors are reported back as strings, as io errors are not Sync
+    codomain_file_entries
+        .into_par_iter()
+        .zip(problem_file_entries.into_par_iter())
+        .map(|(codomain_file_entry, problem_file_entry)| {
+            let clique_tree =
+                read_clique_tree_from_files(&problem_file_entry, &codomain_file_entry, generated)
+                    .map_err(|error| error.to_string())?;
+            Ok((clique_tree, codomain_file_entry))
+        })
+        .collect::<Result<Vec<(CliqueTree, PathBuf)>, String>>()
+        .map_err(|error| error.into())
+}
+
 ///Read the TD Mk Landscapes / clique trees from the codomain and problem folders.
 /// We return a Vector of tuples that contain both the clique tree and the path to the codomain file.
 ///  The path is required to construct the output file path.
@@ -380,13 +1043,29 @@ pub fn read_clique_trees_paths_from_folders(
 }
 
 /// Write problem to file, for possible later use
+/// All sections are formatted into one large reusable buffer that is only handed to the writer
+///  when it fills up, instead of one writer call per section or value
 pub fn write_problem_to_file(
     clique_tree: &CliqueTree,
     output_problem_file_path: &Path,
+) -> Result<(), Box<dyn Error>> {
+    write_problem_to_file_with_buffer(
+        clique_tree,
+        output_problem_file_path,
+        &mut String::with_capacity(super::codomain::WRITE_BUFFER_FLUSH_SIZE),
+    )
+}
+
+///Write the problem to the passed file, reusing the passed formatting buffer,
+/// so generation loops format into one buffer across instances
+pub fn write_problem_to_file_with_buffer(
+    clique_tree: &CliqueTree,
+    output_problem_file_path: &Path,
+    write_buffer: &mut String,
 ) -> Result<(), Box<dyn Error>> {
     let file = File::create(output_problem_file_path)?;
     let mut buf_writer = BufWriter::new(file);
-    let mut write_buffer = String::new();
+    write_buffer.clear();
 
     //Write the input parameters on the first line
     writeln!(
@@ -397,8 +1076,6 @@ pub fn write_problem_to_file(
         clique_tree.input_parameters.o,
         clique_tree.input_parameters.b
     )?;
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
 
     //Global optima fitness and solutions:
     //      fitness
@@ -407,27 +1084,55 @@ pub fn write_problem_to_file(
 
     //fitness
     writeln!(write_buffer, "{}", clique_tree.glob_optima_score)?;
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
 
-    //number_of_solutions
-    writeln!(write_buffer, "{}", clique_tree.glob_optima_strings.len())?;
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
+    //number_of_solutions and solutions.
+    //When the clique tree holds the optima in product form, the count is calculated exactly and the
+    // strings are streamed one at a time from the product form into the write buffer,
+    // so the memory use stays independent of the number of optima
+    match &clique_tree.global_optima {
+        Some(global_optima) => {
+            writeln!(write_buffer, "{}", global_optima.count())?;
 
-    //solutions
-    for sol in &clique_tree.glob_optima_strings {
-        for bit in sol {
-            write!(write_buffer, "{}", bit)?;
+            let mut flush_result: Result<(), std::io::Error> = Ok(());
+            global_optima.for_each_optimum(&clique_tree.cliques, |optimum| {
+                if flush_result.is_err() {
+                    return;
+                }
+                for &bit in optimum {
+                    write_buffer.push(if bit == 0 { '0' } else { '1' });
+                }
+                write_buffer.push('\n');
+                if write_buffer.len() >= super::codomain::WRITE_BUFFER_FLUSH_SIZE {
+                    if let Err(error) = buf_writer.write_all(write_buffer.as_bytes()) {
+                        flush_result = Err(error);
+                    }
+                    write_buffer.clear();
+                }
+            });
+            flush_result?;
+        }
+        None => {
+            writeln!(write_buffer, "{}", clique_tree.glob_optima_strings.len())?;
+
+            for sol in &clique_tree.glob_optima_strings {
+                for bit in sol {
+                    write!(write_buffer, "{}", bit)?;
+                }
+                writeln!(write_buffer)?;
+                if write_buffer.len() >= super::codomain::WRITE_BUFFER_FLUSH_SIZE {
+                    buf_writer.write_all(write_buffer.as_bytes())?;
+                    write_buffer.clear();
+                }
+            }
         }
-        writeln!(write_buffer)?;
     }
-    buf_writer.write_all(write_buffer.as_bytes())?;
-    write_buffer.clear();
 
     //Cliques/Subfunctions
     //      Per clique; variable indices
-    for clique in &clique_tree.cliques {
+    for clique in clique_tree
+        .cliques
+        .chunks(clique_tree.input_parameters.k as usize)
+    {
         for variable_index in clique {
             write!(write_buffer, "{} ", variable_index)?;
         }
@@ -435,6 +1140,10 @@ pub fn write_problem_to_file(
             "could not remove trailing white space from clique indices while writing problem",
         )?;
         writeln!(write_buffer)?;
+        if write_buffer.len() >= super::codomain::WRITE_BUFFER_FLUSH_SIZE {
+            buf_writer.write_all(write_buffer.as_bytes())?;
+            write_buffer.clear();
+        }
     }
     buf_writer.write_all(write_buffer.as_bytes())?;
     write_buffer.clear();
@@ -469,56 +1178,164 @@ pub fn write_problem_to_file_ser(
     Ok(())
 }
 
-///Read problem from file
+///Read problem from file.
+///The whole file is read in one call and parsed from the byte slice,
+/// instead of allocating a String per line through a buffered line reader.
 pub fn read_problem_from_file(file_path: &Path) -> Result<Problem, Box<dyn Error>> {
-    let file = File::open(file_path)?;
-    let reader = BufReader::new(file);
-    let mut content_iter = reader.lines();
+    let contents = fs::read(file_path)?;
+    parse_problem_from_bytes(&contents)
+}
 
-    //Read input parameters
-    let mut line = content_iter.next().ok_or("Empty problem file")??;
-    let parameters: Vec<&str> = line.split(' ').collect();
-    if parameters.len() != 4 {
-        return Err("not enough input parameters on first line of input file".into());
+///Read a problem file without materializing the global optima strings.
+///Only the header (the input parameters, the score and the optimum count) and the clique section
+/// are read; the optima strings section — count lines of exactly problem_size bits, as written by
+/// write_problem_to_file — is skipped with one seek, so reading an NKq problem file with millions
+/// of optima costs the same as reading one without any.
+///The returned Problem has an empty glob_optima_strings, and the count is returned alongside it;
+/// use read_problem_from_file when the strings themselves are needed.
+pub fn read_problem_from_file_skip_optima(
+    file_path: &Path,
+) -> Result<(Problem, usize), Box<dyn Error>> {
+    use std::io::{Read, Seek, SeekFrom};
+
+    let mut file = File::open(file_path)?;
+
+    //The header is four parameters, the score and the count: comfortably within one small read
+    let mut header = [0u8; 256];
+    let mut header_length = 0;
+    while header_length < header.len() {
+        let bytes_read = file.read(&mut header[header_length..])?;
+        if bytes_read == 0 {
+            break;
+        }
+        header_length += bytes_read;
     }
-    //And set the parameters
-    let m: u32 = parameters[0].parse()?;
-    let k: u32 = parameters[1].parse()?;
-    let o: u32 = parameters[2].parse()?;
-    let b: u32 = parameters[3].parse()?;
+    let header = &header[..header_length];
+
+    let mut offset = 0;
+    let m: u32 = parse_next_token(header, &mut offset, "No parameter m in problem file")?;
+    let k: u32 = parse_next_token(header, &mut offset, "No parameter k in problem file")?;
+    let o: u32 = parse_next_token(header, &mut offset, "No parameter o in problem file")?;
+    let b: u32 = parse_next_token(header, &mut offset, "No parameter b in problem file")?;
+    let glob_optima_score: f64 = parse_next_token(
+        header,
+        &mut offset,
+        "No global optimum score in problem file",
+    )?;
+    let number_of_global_optima: usize = parse_next_token(
+        header,
+        &mut offset,
+        "No number_of_global_optima line in problem file",
+    )?;
 
     let input_parameters = InputParameters::new_from_primitives(m, k, o, b);
+    let problem_size = ((m - 1) * (k - o) + k) as usize;
 
-    let problem_size = (m - 1) * (k - o) + k;
+    //Every optimum line is problem_size bits plus its newline, and the offset stands on the
+    // newline after the count token, so the clique section starts at one known byte position
+    let cliques_start =
+        offset as u64 + 1 + (number_of_global_optima * (problem_size + 1)) as u64;
+    file.seek(SeekFrom::Start(cliques_start))?;
+    let mut clique_bytes = Vec::new();
+    file.read_to_end(&mut clique_bytes)?;
 
-    //Read global optmium score
-    line = content_iter
-        .next()
-        .ok_or("No global optimum score in problem file")??;
-    let glob_optima_score: f64 = line.parse()?;
+    let mut offset = 0;
+    let mut cliques = Vec::with_capacity(m as usize);
+    for _i in 0..m as usize {
+        let mut clique_indices: Vec<u32> = Vec::with_capacity(k as usize);
+        for _j in 0..k as usize {
+            clique_indices.push(parse_next_token(
+                &clique_bytes,
+                &mut offset,
+                "Not enough variable indices in cliques in problem file",
+            )?);
+        }
+        cliques.push(clique_indices);
+    }
 
-    //Read number_of_global_optima
-    line = content_iter
-        .next()
-        .ok_or("No number_of_global_optima line in problem file")??;
-    let number_of_global_optima: usize = line.parse()?;
+    Ok((
+        Problem {
+            input_parameters,
+            glob_optima_score,
+            glob_optima_strings: Vec::new(),
+            cliques,
+        },
+        number_of_global_optima,
+    ))
+}
+
+///Advance the offset to the next whitespace-delimited token in the byte slice and return it,
+/// or None when the slice is exhausted
+fn next_token<'a>(contents: &'a [u8], offset: &mut usize) -> Option<&'a [u8]> {
+    while *offset < contents.len() && contents[*offset].is_ascii_whitespace() {
+        *offset += 1;
+    }
+    let token_start = *offset;
+    while *offset < contents.len() && !contents[*offset].is_ascii_whitespace() {
+        *offset += 1;
+    }
+    if token_start == *offset {
+        None
+    } else {
+        Some(&contents[token_start..*offset])
+    }
+}
+
+///Parse the next token of the byte slice as a number,
+/// with the passed description naming the token in the error on a missing or malformed token
+fn parse_next_token<T: std::str::FromStr>(
+    contents: &[u8],
+    offset: &mut usize,
+    description: &'static str,
+) -> Result<T, Box<dyn Error>> {
+    let token = next_token(contents, offset).ok_or(description)?;
+    std::str::from_utf8(token)?
+        .parse()
+        .map_err(|_| description.into())
+}
+
+///Parse a problem in the text format of write_problem_to_file from a whole-file byte slice.
+///The parse is a single pass over the bytes: the numbers are parsed in place from their tokens
+/// and the optima bit strings are converted digit by digit, without intermediate line Strings.
+pub fn parse_problem_from_bytes(contents: &[u8]) -> Result<Problem, Box<dyn Error>> {
+    let mut offset = 0;
+
+    //Read input parameters
+    let m: u32 = parse_next_token(contents, &mut offset, "No parameter m in problem file")?;
+    let k: u32 = parse_next_token(contents, &mut offset, "No parameter k in problem file")?;
+    let o: u32 = parse_next_token(contents, &mut offset, "No parameter o in problem file")?;
+    let b: u32 = parse_next_token(contents, &mut offset, "No parameter b in problem file")?;
+
+    let input_parameters = InputParameters::new_from_primitives(m, k, o, b);
+
+    let problem_size = (m - 1) * (k - o) + k;
+
+    //Read global optimum score and number_of_global_optima
+    let glob_optima_score: f64 = parse_next_token(
+        contents,
+        &mut offset,
+        "No global optimum score in problem file",
+    )?;
+    let number_of_global_optima: usize = parse_next_token(
+        contents,
+        &mut offset,
+        "No number_of_global_optima line in problem file",
+    )?;
 
     //Read global optima
     let mut glob_optima_strings = Vec::with_capacity(number_of_global_optima);
     for _i in 0..number_of_global_optima {
-        line = content_iter
-            .next()
-            .ok_or("Not enough global optima strings in problem file")??;
-        let mut chars = line.chars();
+        let bits =
+            next_token(contents, &mut offset).ok_or("Not enough global optima strings in problem file")?;
+        if bits.len() != problem_size as usize {
+            return Err("global optimum in problem file does not contain enough bits".into());
+        }
         let mut global_optimum: Vec<u32> = Vec::with_capacity(problem_size as usize);
-        for _j in 0..problem_size as usize {
-            let bit = chars
-                .next()
-                .ok_or("global optimum in problem file does not contain enough bits")?;
-            global_optimum.push(
-                bit.to_digit(10)
-                    .ok_or("Could not convert global optimum bit from char to u32")?,
-            );
+        for &bit in bits {
+            if !bit.is_ascii_digit() {
+                return Err("Could not convert global optimum bit from char to u32".into());
+            }
+            global_optimum.push((bit - b'0') as u32);
         }
         glob_optima_strings.push(global_optimum);
     }
@@ -526,16 +1343,13 @@ pub fn read_problem_from_file(file_path: &Path) -> Result<Problem, Box<dyn Error
     //Read clique_tree cliques
     let mut cliques = Vec::with_capacity(m as usize);
     for _i in 0..m as usize {
-        line = content_iter
-            .next()
-            .ok_or("Not enough cliques in problem file")??;
-        let variable_indices: Vec<&str> = line.split(' ').collect();
-        if variable_indices.len() != k as usize {
-            return Err("not enough variable indices in clique indices".into());
-        }
         let mut clique_indices: Vec<u32> = Vec::with_capacity(k as usize);
-        for j in 0..k as usize {
-            clique_indices.push(variable_indices[j].parse()?);
+        for _j in 0..k as usize {
+            clique_indices.push(parse_next_token(
+                contents,
+                &mut offset,
+                "Not enough variable indices in cliques in problem file",
+            )?);
         }
         cliques.push(clique_indices);
     }
@@ -557,3 +1371,201 @@ pub fn read_problem_from_file_de(file_path: &Path) -> Result<Problem, Box<dyn Er
     let problem = ron::de::from_reader(&mut reader)?;
     Ok(problem)
 }
+
+///Magic bytes identifying a binary problem file
+pub const PROBLEM_BINARY_MAGIC: &[u8; 8] = b"TDMKPROB";
+///Version of the binary problem format, bumped on incompatible layout changes
+pub const PROBLEM_BINARY_VERSION: u32 = 1;
+
+///Write the problem to the passed file in the binary format:
+/// magic bytes, format version, the input parameters m/k/o/b, the global optimum score as a
+/// little-endian f64, the number of global optima as a little-endian u64, the optima strings with
+/// bit j of each string packed into bit (j % 8) of byte (j / 8), and then the m * k clique variable
+/// indices as a dense little-endian u32 array.
+///The RON serialization remains available for interop; the binary format exists because
+/// pretty-printed numeric matrices are huge and dominate experiment startup when
+/// thousands of problems are loaded.
+pub fn write_problem_binary(problem: &Problem, file_path: &Path) -> Result<(), Box<dyn Error>> {
+    let file = File::create(file_path)?;
+    let mut buf_writer = BufWriter::new(file);
+    buf_writer.write_all(&encode_problem_binary(problem))?;
+    buf_writer.flush()?;
+
+    Ok(())
+}
+
+///Encode the problem in the binary format into a byte buffer; the record layout of
+/// write_problem_binary, usable as an archive record as well as a standalone file
+pub fn encode_problem_binary(problem: &Problem) -> Vec<u8> {
+    let mut encoded = Vec::with_capacity(1 << 12);
+
+    //Write the magic bytes and format version
+    encoded.extend_from_slice(PROBLEM_BINARY_MAGIC);
+    encoded.extend_from_slice(&PROBLEM_BINARY_VERSION.to_le_bytes());
+
+    //Write the input parameters
+    for parameter in [
+        problem.input_parameters.m,
+        problem.input_parameters.k,
+        problem.input_parameters.o,
+        problem.input_parameters.b,
+    ] {
+        encoded.extend_from_slice(&parameter.to_le_bytes());
+    }
+
+    //Write the global optimum score and the number of global optima
+    encoded.extend_from_slice(&problem.glob_optima_score.to_le_bytes());
+    encoded.extend_from_slice(&(problem.glob_optima_strings.len() as u64).to_le_bytes());
+
+    //Write the global optima strings, bit-packed into bytes
+    for glob_optima_string in &problem.glob_optima_strings {
+        let mut packed_bytes = vec![0u8; (glob_optima_string.len() + 7) / 8];
+        for (bit_index, &bit) in glob_optima_string.iter().enumerate() {
+            packed_bytes[bit_index / 8] |= (bit as u8) << (bit_index % 8);
+        }
+        encoded.extend_from_slice(&packed_bytes);
+    }
+
+    //Write the dense clique variable index array
+    for clique in &problem.cliques {
+        for &variable_index in clique {
+            encoded.extend_from_slice(&variable_index.to_le_bytes());
+        }
+    }
+
+    encoded
+}
+
+///Read a binary problem file as written by write_problem_binary.
+///The whole file is read in one call and decoded in a single pass over the bytes,
+/// instead of parsing one ASCII number per line.
+pub fn read_problem_binary(file_path: &Path) -> Result<Problem, Box<dyn Error>> {
+    let contents = fs::read(file_path)?;
+    decode_problem_binary(&contents)
+}
+
+///Decode a binary problem record as encoded by encode_problem_binary
+pub fn decode_problem_binary(contents: &[u8]) -> Result<Problem, Box<dyn Error>> {
+    //Validate the magic bytes and format version
+    if contents.len() < PROBLEM_BINARY_MAGIC.len() + 4
+        || &contents[..PROBLEM_BINARY_MAGIC.len()] != PROBLEM_BINARY_MAGIC
+    {
+        return Err("File is not a binary problem file (wrong magic bytes)".into());
+    }
+    let mut offset = PROBLEM_BINARY_MAGIC.len();
+    let version = read_binary_u32(
+        contents,
+        &mut offset,
+        "Binary problem file is truncated in the format version",
+    )?;
+    if version != PROBLEM_BINARY_VERSION {
+        return Err("Unsupported binary problem format version".into());
+    }
+
+    //Read the input parameters
+    let mut parameters = [0u32; 4];
+    for parameter in parameters.iter_mut() {
+        *parameter = read_binary_u32(
+            contents,
+            &mut offset,
+            "Binary problem file is truncated in the input parameters",
+        )?;
+    }
+    let input_parameters = InputParameters::new_from_primitives(
+        parameters[0],
+        parameters[1],
+        parameters[2],
+        parameters[3],
+    );
+    if input_parameters.m == 0 || input_parameters.k <= input_parameters.o {
+        return Err("Binary problem file declares invalid input parameters".into());
+    }
+    let problem_size = (input_parameters.m as usize - 1)
+        * (input_parameters.k - input_parameters.o) as usize
+        + input_parameters.k as usize;
+
+    //Read the global optimum score and the number of global optima
+    let glob_optima_score = read_binary_f64(
+        contents,
+        &mut offset,
+        "Binary problem file is truncated in the global optimum score",
+    )?;
+    let number_of_global_optima = read_binary_u64(
+        contents,
+        &mut offset,
+        "Binary problem file is truncated in the number of global optima",
+    )? as usize;
+
+    //Decode the bit-packed global optima strings; the expected byte count is computed with
+    // checked arithmetic, so implausible counts are rejected instead of overflowing
+    let packed_string_length = (problem_size + 7) / 8;
+    let number_of_clique_bytes = (input_parameters.m as usize)
+        .checked_mul(input_parameters.k as usize)
+        .and_then(|number_of_indices| number_of_indices.checked_mul(4))
+        .ok_or("Binary problem file declares implausibly large input parameters")?;
+    let expected_remaining_bytes = number_of_global_optima
+        .checked_mul(packed_string_length)
+        .and_then(|optima_bytes| optima_bytes.checked_add(number_of_clique_bytes))
+        .ok_or("Binary problem file declares implausibly many global optima")?;
+    if contents.len() - offset != expected_remaining_bytes {
+        return Err("Binary problem file does not contain the expected number of bytes".into());
+    }
+    let mut glob_optima_strings = Vec::with_capacity(number_of_global_optima);
+    for _i in 0..number_of_global_optima {
+        let packed_bytes = &contents[offset..offset + packed_string_length];
+        glob_optima_strings.push(
+            (0..problem_size)
+                .map(|bit_index| ((packed_bytes[bit_index / 8] >> (bit_index % 8)) & 1) as u32)
+                .collect(),
+        );
+        offset += packed_string_length;
+    }
+
+    //Decode the dense clique variable index array
+    let cliques = contents[offset..]
+        .chunks_exact(4 * input_parameters.k as usize)
+        .map(|clique_bytes| {
+            clique_bytes
+                .chunks_exact(4)
+                .map(|bytes| u32::from_le_bytes(bytes.try_into().unwrap()))
+                .collect()
+        })
+        .collect();
+
+    Ok(Problem {
+        input_parameters,
+        glob_optima_score,
+        glob_optima_strings,
+        cliques,
+    })
+}
+
+///Write problem to file using the binary serialization, the compact counterpart of write_problem_to_file_ser
+pub fn write_problem_to_file_bin(
+    clique_tree: &CliqueTree,
+    file_path: &Path,
+) -> Result<(), Box<dyn Error>> {
+    write_problem_binary(&Problem::new(clique_tree), file_path)
+}
+
+///Read all binary problem files in the passed folder, in sorted file order,
+/// with the files spread over a rayon thread pool
+pub fn read_problems_binary_from_folder(
+    folder_path: &Path,
+) -> Result<Vec<(Problem, PathBuf)>, Box<dyn Error>> {
+    let file_paths: Vec<PathBuf> = folder_path
+        .read_dir()?
+        .map(|file| file.unwrap().path())
+        .sorted()
+        .collect();
+
+    //Errors are reported back as strings, as io errors are not Sync
+    file_paths
+        .into_par_iter()
+        .map(|path| {
+            let problem = read_problem_binary(&path).map_err(|error| error.to_string())?;
+            Ok((problem, path))
+        })
+        .collect::<Result<Vec<(Problem, PathBuf)>, String>>()
+        .map_err(|error| error.into())
+}
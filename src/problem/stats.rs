@@ -0,0 +1,199 @@
+/*!
+Module for lightweight instrumentation of the generation pipeline: per-stage wall time, bytes
+written and optima counts, accumulated across instances and reported once per run.
+*/
+
+use std::fmt::Write as fmt_write;
+use std::time::{Duration, Instant};
+
+///The stages of the per-instance generation pipeline, in pipeline order
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum GenerationStage {
+    CodomainGeneration,
+    CodomainWrite,
+    TreeConstruction,
+    OptimaCalculation,
+    ProblemWrite,
+}
+
+impl GenerationStage {
+    ///All stages, in pipeline order; the index of a stage in this list is its slot in the stats
+    const ALL: [GenerationStage; 5] = [
+        GenerationStage::CodomainGeneration,
+        GenerationStage::CodomainWrite,
+        GenerationStage::TreeConstruction,
+        GenerationStage::OptimaCalculation,
+        GenerationStage::ProblemWrite,
+    ];
+
+    fn name(self) -> &'static str {
+        match self {
+            GenerationStage::CodomainGeneration => "codomain_generation",
+            GenerationStage::CodomainWrite => "codomain_write",
+            GenerationStage::TreeConstruction => "tree_construction",
+            GenerationStage::OptimaCalculation => "optima_calculation",
+            GenerationStage::ProblemWrite => "problem_write",
+        }
+    }
+}
+
+///Accumulated measurements of one pipeline stage
+#[derive(Clone, Copy, Debug, Default)]
+struct StageStats {
+    calls: u64,
+    total_time: Duration,
+    bytes_written: u64,
+}
+
+///Accumulated measurements of a generation run, aggregated across instances.
+///The whole surface is behind a runtime switch: a disabled stats struct never reads the clock
+/// and never touches the counters — every recording method starts with one branch on `enabled` —
+/// so the uninstrumented pipeline keeps its exact cost.
+#[derive(Clone, Debug)]
+pub struct GenerationStats {
+    enabled: bool,
+    instances: u64,
+    total_optima: u128,
+    stages: [StageStats; GenerationStage::ALL.len()],
+}
+
+impl GenerationStats {
+    pub fn new(enabled: bool) -> GenerationStats {
+        GenerationStats {
+            enabled,
+            instances: 0,
+            total_optima: 0,
+            stages: [StageStats::default(); GenerationStage::ALL.len()],
+        }
+    }
+
+    ///A stats struct that records nothing; the default for uninstrumented callers
+    pub fn disabled() -> GenerationStats {
+        GenerationStats::new(false)
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.enabled
+    }
+
+    ///Start timing a stage; None when disabled, so the clock is never read
+    #[inline]
+    pub fn stage_start(&self) -> Option<Instant> {
+        if self.enabled {
+            Some(Instant::now())
+        } else {
+            None
+        }
+    }
+
+    ///Record the wall time of a stage from its start mark, as returned by stage_start
+    #[inline]
+    pub fn record_stage(&mut self, stage: GenerationStage, stage_start: Option<Instant>) {
+        if let Some(stage_start) = stage_start {
+            let stage_stats = &mut self.stages[stage as usize];
+            stage_stats.calls += 1;
+            stage_stats.total_time += stage_start.elapsed();
+        }
+    }
+
+    ///Record bytes written by a stage; a separate call, as the byte count (file size) is only
+    /// determined after the stage has been timed
+    #[inline]
+    pub fn record_bytes_written(&mut self, stage: GenerationStage, bytes_written: u64) {
+        if self.enabled {
+            self.stages[stage as usize].bytes_written += bytes_written;
+        }
+    }
+
+    ///Record one completed instance and its number of global optima
+    #[inline]
+    pub fn record_instance(&mut self, number_of_global_optima: u128) {
+        if self.enabled {
+            self.instances += 1;
+            self.total_optima += number_of_global_optima;
+        }
+    }
+
+    ///Fold the measurements of another stats struct into this one; used to aggregate the
+    /// per-worker stats of a parallel run
+    pub fn merge(&mut self, other: &GenerationStats) {
+        if !self.enabled {
+            return;
+        }
+        self.instances += other.instances;
+        self.total_optima += other.total_optima;
+        for (stage_stats, other_stage_stats) in self.stages.iter_mut().zip(other.stages.iter()) {
+            stage_stats.calls += other_stage_stats.calls;
+            stage_stats.total_time += other_stage_stats.total_time;
+            stage_stats.bytes_written += other_stage_stats.bytes_written;
+        }
+    }
+
+    ///Format the accumulated measurements as a human-readable table
+    pub fn human_table(&self) -> String {
+        let mut table = String::new();
+        let _ = writeln!(
+            table,
+            "{:<20} {:>10} {:>14} {:>12} {:>15}",
+            "stage", "calls", "total (s)", "mean (ms)", "bytes written"
+        );
+        for stage in GenerationStage::ALL.iter() {
+            let stage_stats = &self.stages[*stage as usize];
+            let total_seconds = stage_stats.total_time.as_secs_f64();
+            let mean_milliseconds = if stage_stats.calls > 0 {
+                total_seconds * 1000.0 / stage_stats.calls as f64
+            } else {
+                0.0
+            };
+            let _ = writeln!(
+                table,
+                "{:<20} {:>10} {:>14.3} {:>12.3} {:>15}",
+                stage.name(),
+                stage_stats.calls,
+                total_seconds,
+                mean_milliseconds,
+                stage_stats.bytes_written
+            );
+        }
+        let _ = writeln!(
+            table,
+            "instances: {}, total optima: {}",
+            self.instances, self.total_optima
+        );
+        table
+    }
+
+    ///Format the accumulated measurements as one machine-readable JSON line
+    pub fn json(&self) -> String {
+        let mut json = String::new();
+        let _ = write!(
+            json,
+            "{{\"instances\":{},\"total_optima\":{},\"stages\":[",
+            self.instances, self.total_optima
+        );
+        for (stage_index, stage) in GenerationStage::ALL.iter().enumerate() {
+            let stage_stats = &self.stages[*stage as usize];
+            if stage_index > 0 {
+                json.push(',');
+            }
+            let _ = write!(
+                json,
+                "{{\"stage\":\"{}\",\"calls\":{},\"total_seconds\":{},\"bytes_written\":{}}}",
+                stage.name(),
+                stage_stats.calls,
+                stage_stats.total_time.as_secs_f64(),
+                stage_stats.bytes_written
+            );
+        }
+        json.push_str("]}");
+        json
+    }
+
+    ///Print the human table and the JSON line, the report at the end of an instrumented run
+    pub fn report(&self) {
+        if self.enabled {
+            print!("{}", self.human_table());
+            println!("{}", self.json());
+        }
+    }
+}
@@ -2,6 +2,11 @@ use std::path::PathBuf;
 use std::fs;
 
 use problem_generator::{self, problem::problem_generation::{run_opt, ProblemOpt, ProblemCommand::ConfigurationFolder}};
+use problem_generator::problem::problem_generation::{generate_codomain_and_problem_archive, read_problem_binary, read_problem_from_file, read_problem_from_file_skip_optima, write_problem_binary, write_problem_to_file, Problem};
+use problem_generator::problem::archive::ArchiveReader;
+use problem_generator::problem::clique_tree::{CliqueTree, InputParameters};
+use problem_generator::problem::codomain::{generate_codomain, read_codomain_binary, write_codomain_binary};
+use problem_generator::problem::codomain_subclasses::CodomainFunction;
 
 //DEV: when changes are made to the reproducability in any way, regenerate the problem output to add here, by running:
 // ./target/release/problem_generator -s 2398 configuration_folder ./data/tiny_test
@@ -10,6 +15,7 @@ fn deceptive_trap_generated() {
     let problem_command = ConfigurationFolder {
         folder_paths: vec![PathBuf::from("./data/tiny_test")],
         number_of_problems_to_generate: 1,
+        stats: false,
     };
 
     let problem_opt = ProblemOpt {
@@ -86,4 +92,317 @@ fn deceptive_trap_generated() {
         .expect("Could not read codomain result from problem generation");
 
     assert_eq!(codomain_actual_output, codomain_expected_output);
-}
\ No newline at end of file
+}
+
+#[test]
+fn binary_codomain_round_trip() {
+    let input_parameters = InputParameters::new_from_primitives(3, 2, 1, 2);
+    let codomain_function = CodomainFunction::NKq { q: 4 };
+    let codomain: Vec<f64> = (0..3 * 4).map(|value| value as f64 / 3.0).collect();
+
+    let mut file_path = std::env::temp_dir();
+    file_path.push("problem_generator_binary_codomain_round_trip.bin");
+
+    write_codomain_binary(&input_parameters, &codomain_function, &file_path, &codomain)
+        .expect("Could not write binary codomain file");
+    let (read_function, read_parameters, read_codomain) =
+        read_codomain_binary(&file_path).expect("Could not read binary codomain file");
+    fs::remove_file(&file_path).expect("Could not remove binary codomain file");
+
+    assert_eq!(read_function, codomain_function);
+    assert_eq!(read_parameters, input_parameters);
+    assert_eq!(read_codomain, codomain);
+}
+
+#[test]
+fn binary_problem_round_trip() {
+    let problem = Problem {
+        input_parameters: InputParameters::new_from_primitives(3, 3, 1, 2),
+        glob_optima_score: 2.5,
+        glob_optima_strings: vec![vec![0, 1, 1, 0, 1, 0, 1], vec![1, 0, 1, 1, 0, 0, 1]],
+        cliques: vec![vec![2, 0, 1], vec![2, 3, 4], vec![2, 5, 6]],
+    };
+
+    let mut file_path = std::env::temp_dir();
+    file_path.push("problem_generator_binary_problem_round_trip.bin");
+
+    write_problem_binary(&problem, &file_path).expect("Could not write binary problem file");
+    let read_problem = read_problem_binary(&file_path).expect("Could not read binary problem file");
+    fs::remove_file(&file_path).expect("Could not remove binary problem file");
+
+    assert_eq!(read_problem.input_parameters, problem.input_parameters);
+    assert_eq!(read_problem.glob_optima_score, problem.glob_optima_score);
+    assert_eq!(read_problem.glob_optima_strings, problem.glob_optima_strings);
+    assert_eq!(read_problem.cliques, problem.cliques);
+}
+
+#[test]
+fn batch_fitness_matches_single() {
+    let input_parameters = InputParameters::new_from_primitives(5, 3, 1, 2);
+    let codomain_function = CodomainFunction::DeceptiveTrap;
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    let codomain = generate_codomain(&input_parameters, &codomain_function, &mut rng);
+    let clique_tree = CliqueTree::new(input_parameters, codomain_function, codomain, &mut rng);
+
+    //All 2^11 solutions of the 5_3_1_2 problem as the population
+    let problem_size = 11;
+    let solutions: Vec<Vec<u32>> = (0u32..1 << problem_size)
+        .map(|string_index| {
+            (0..problem_size)
+                .map(|position| (string_index >> (problem_size - 1 - position)) & 1)
+                .collect()
+        })
+        .collect();
+
+    let mut number_evaluations = 0;
+    let single_fitnesses: Vec<f64> = solutions
+        .iter()
+        .map(|solution| clique_tree.calculate_fitness(solution, &mut number_evaluations))
+        .collect();
+
+    let mut batch_evaluations = 0;
+    let batch_fitnesses = clique_tree.calculate_fitness_batch(&solutions, &mut batch_evaluations);
+    assert_eq!(batch_fitnesses, single_fitnesses);
+    assert_eq!(batch_evaluations, number_evaluations);
+
+    let mut parallel_evaluations = 0;
+    let parallel_fitnesses =
+        clique_tree.calculate_fitness_batch_parallel(&solutions, &mut parallel_evaluations);
+    assert_eq!(parallel_fitnesses, single_fitnesses);
+    assert_eq!(parallel_evaluations, number_evaluations);
+}
+
+#[test]
+fn parallel_optimum_dp_matches_sequential() {
+    //A three-level tree with a partially filled lowest level, and a tie-heavy NKq codomain
+    let input_parameters = InputParameters::new_from_primitives(11, 4, 2, 3);
+    let codomain_function = CodomainFunction::NKq { q: 4 };
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    let codomain_values: Vec<f64> =
+        generate_codomain(&input_parameters, &codomain_function, &mut rng)
+            .into_iter()
+            .flatten()
+            .collect();
+    let (cliques, separators) = CliqueTree::construct(&input_parameters, &mut rng);
+
+    let sequential = CliqueTree::calculate_global_optima_product(
+        &input_parameters,
+        &codomain_function,
+        &codomain_values,
+        &cliques,
+        &separators,
+    );
+    let parallel = CliqueTree::calculate_global_optima_product_parallel(
+        &input_parameters,
+        &codomain_values,
+        &cliques,
+        &separators,
+    );
+
+    assert_eq!(parallel.score, sequential.score);
+    assert_eq!(parallel.count(), sequential.count());
+    assert_eq!(parallel.enumerate(&cliques), sequential.enumerate(&cliques));
+}
+
+#[test]
+fn incremental_evaluator_matches_full_evaluation() {
+    let input_parameters = InputParameters::new_from_primitives(5, 3, 1, 2);
+    let codomain_function = CodomainFunction::DeceptiveTrap;
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    let codomain = generate_codomain(&input_parameters, &codomain_function, &mut rng);
+    let clique_tree = CliqueTree::new(input_parameters, codomain_function, codomain, &mut rng);
+
+    let mut evaluator = clique_tree.incremental_evaluator(&vec![0; 11]);
+    let mut number_evaluations = 0;
+
+    //Multi-bit moves of different sizes, including bits that share a clique
+    let moves: Vec<Vec<u32>> = vec![
+        vec![9, 8, 10],
+        vec![0, 4],
+        vec![9],
+        vec![1, 2, 3, 5, 6, 7],
+        vec![9, 8, 10, 0],
+    ];
+    for flipped_variable_indices in &moves {
+        let incremental_fitness =
+            evaluator.apply_flips(flipped_variable_indices, &mut number_evaluations);
+        let full_fitness =
+            clique_tree.calculate_fitness(evaluator.solution(), &mut number_evaluations);
+        assert!((incremental_fitness - full_fitness).abs() < 1e-9);
+        assert_eq!(evaluator.fitness(), incremental_fitness);
+    }
+}
+
+#[test]
+fn problem_text_parse_round_trip() {
+    let input_parameters = InputParameters::new_from_primitives(5, 3, 1, 2);
+    let codomain_function = CodomainFunction::DeceptiveTrap;
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    let codomain = generate_codomain(&input_parameters, &codomain_function, &mut rng);
+    let clique_tree = CliqueTree::new(input_parameters, codomain_function, codomain, &mut rng);
+
+    let mut file_path = std::env::temp_dir();
+    file_path.push("problem_generator_problem_text_parse_round_trip.txt");
+
+    write_problem_to_file(&clique_tree, &file_path).expect("Could not write problem file");
+    let problem = read_problem_from_file(&file_path).expect("Could not read problem file");
+
+    //The skip-optima reader must agree with the full reader on everything but the strings
+    let (skipped_problem, number_of_global_optima) =
+        read_problem_from_file_skip_optima(&file_path)
+            .expect("Could not read problem file without optima strings");
+    fs::remove_file(&file_path).expect("Could not remove problem file");
+
+    assert_eq!(skipped_problem.input_parameters, problem.input_parameters);
+    assert_eq!(skipped_problem.glob_optima_score, problem.glob_optima_score);
+    assert_eq!(number_of_global_optima, problem.glob_optima_strings.len());
+    assert!(skipped_problem.glob_optima_strings.is_empty());
+    assert_eq!(skipped_problem.cliques, problem.cliques);
+
+    assert_eq!(problem.input_parameters, clique_tree.input_parameters);
+    assert_eq!(problem.glob_optima_score, clique_tree.glob_optima_score);
+    //The written optima are streamed from the product form, so compare against its enumeration
+    assert_eq!(
+        problem.glob_optima_strings,
+        clique_tree
+            .global_optima
+            .as_ref()
+            .expect("Clique tree should hold the optima in product form")
+            .enumerate(&clique_tree.cliques)
+    );
+    let flat_cliques: Vec<u32> = problem.cliques.into_iter().flatten().collect();
+    assert_eq!(flat_cliques, clique_tree.cliques);
+}
+
+#[test]
+fn configuration_space_indexing_matches_iterator() {
+    use problem_generator::problem::configuration::ConfigurationParameters;
+    use rayon::prelude::*;
+
+    //A space with proper ranges and a collapsed dimension (o), and a fully collapsed space
+    let spaces = vec![
+        ConfigurationParameters::new(5, 8, 3, 6, 1, 1, 2, 4, CodomainFunction::DeceptiveTrap),
+        ConfigurationParameters::new(5, 5, 3, 3, 1, 1, 2, 2, CodomainFunction::DeceptiveTrap),
+    ];
+    for configuration_parameters in spaces {
+        let sequential: Vec<InputParameters> =
+            configuration_parameters.clone().into_iter().collect();
+        assert_eq!(configuration_parameters.len(), sequential.len());
+
+        let indexed: Vec<InputParameters> = (0..configuration_parameters.len())
+            .map(|index| configuration_parameters.get(index))
+            .collect();
+        assert_eq!(indexed, sequential);
+
+        let parallel: Vec<InputParameters> = configuration_parameters.par_iter().collect();
+        assert_eq!(parallel, sequential);
+    }
+}
+
+#[test]
+fn ffi_evaluation_matches_native() {
+    use problem_generator::ffi;
+    use problem_generator::problem::clique_tree::PackedSolution;
+    use problem_generator::problem::codomain::generate_write_return;
+    use std::ffi::CString;
+
+    let input_parameters = InputParameters::new_from_primitives(5, 3, 1, 2);
+    let codomain_function = CodomainFunction::DeceptiveTrap;
+
+    let mut problem_path = std::env::temp_dir();
+    problem_path.push("problem_generator_ffi_problem.txt");
+    let mut codomain_path = std::env::temp_dir();
+    codomain_path.push("problem_generator_ffi_codomain.txt");
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    let codomain =
+        generate_write_return(&input_parameters, &codomain_function, &codomain_path, &mut rng)
+            .expect("Could not write codomain file");
+    let clique_tree = CliqueTree::new(input_parameters, codomain_function, codomain, &mut rng);
+    write_problem_to_file(&clique_tree, &problem_path).expect("Could not write problem file");
+
+    let problem_path_c = CString::new(problem_path.to_str().unwrap()).unwrap();
+    let codomain_path_c = CString::new(codomain_path.to_str().unwrap()).unwrap();
+    unsafe {
+        let handle = ffi::tdmk_load(problem_path_c.as_ptr(), codomain_path_c.as_ptr(), 1);
+        assert!(!handle.is_null());
+        assert_eq!(ffi::tdmk_problem_size(handle), 11);
+        assert_eq!(ffi::tdmk_global_optimum_score(handle), 4.8);
+
+        //Every solution must evaluate to the native fitness, and its single-bit delta must match
+        let mut number_evaluations = 0;
+        for string_index in 0u32..1 << 11 {
+            let solution: Vec<u32> = (0..11)
+                .map(|position| (string_index >> (11 - 1 - position)) & 1)
+                .collect();
+            let packed = PackedSolution::from_bits(&solution);
+            let native_fitness =
+                clique_tree.calculate_fitness(&solution, &mut number_evaluations);
+            let ffi_fitness = ffi::tdmk_evaluate(handle, packed.words().as_ptr());
+            assert!((ffi_fitness - native_fitness).abs() < 1e-9);
+
+            let mut flipped = solution.clone();
+            flipped[3] ^= 1;
+            let flipped_fitness =
+                clique_tree.calculate_fitness(&flipped, &mut number_evaluations);
+            let ffi_delta_fitness =
+                ffi::tdmk_evaluate_delta(handle, packed.words().as_ptr(), ffi_fitness, 3);
+            assert!((ffi_delta_fitness - flipped_fitness).abs() < 1e-9);
+
+            let is_optimum = clique_tree
+                .global_optima
+                .as_ref()
+                .unwrap()
+                .contains(&clique_tree.cliques, &solution);
+            assert_eq!(
+                ffi::tdmk_is_global_optimum(handle, packed.words().as_ptr(), ffi_fitness),
+                is_optimum as i32
+            );
+        }
+        ffi::tdmk_free(handle);
+    }
+
+    fs::remove_file(&problem_path).expect("Could not remove problem file");
+    fs::remove_file(&codomain_path).expect("Could not remove codomain file");
+}
+
+#[test]
+fn archive_round_trip() {
+    let mut archive_path = std::env::temp_dir();
+    archive_path.push("problem_generator_archive_round_trip.tdmk");
+
+    let mut rng = problem_generator::problem::configuration::get_rng(Some(2398));
+    generate_codomain_and_problem_archive(
+        &PathBuf::from("./data/tiny_test/problem_generation/deceptive_trap.txt"),
+        &archive_path,
+        1,
+        &mut rng,
+    )
+    .expect("Could not generate archive");
+
+    let archive_reader = ArchiveReader::open(&archive_path).expect("Could not open archive");
+    assert_eq!(archive_reader.len(), 1);
+    assert_eq!(archive_reader.entries()[0].name, "deceptive-trap_5_3_1_2_0");
+
+    //The instance uses the same RNG draws as the per-file pipeline with the same seed,
+    // so it must match the known generated problem
+    let clique_tree = archive_reader
+        .read_clique_tree(0)
+        .expect("Could not read clique tree from archive");
+    assert_eq!(
+        clique_tree.input_parameters,
+        InputParameters::new_from_primitives(5, 3, 1, 2)
+    );
+    assert_eq!(clique_tree.glob_optima_score, 4.8);
+    assert_eq!(
+        clique_tree.glob_optima_strings,
+        vec![vec![0, 0, 0, 1, 0, 1, 1, 1, 1, 0, 0]]
+    );
+    assert_eq!(clique_tree.cliques[0..3], [9, 8, 10]);
+
+    fs::remove_file(&archive_path).expect("Could not remove archive file");
+}